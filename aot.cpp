@@ -0,0 +1,270 @@
+#include "aot.h"
+
+#include <cstdlib>
+#include <iostream>
+
+using namespace std;
+
+namespace aot {
+
+    using runtime::ClassInstance;
+    using runtime::Closure;
+    using runtime::Context;
+    using runtime::ObjectHolder;
+
+    namespace {
+        const string INIT_METHOD = "__init__"s;
+        const string ADD_METHOD = "__add__"s;
+    } // namespace
+
+    NativeBody::NativeBody(MethodFunction function)
+        : function_(function) {
+    }
+
+    ObjectHolder NativeBody::Execute(Closure& closure, Context& context) {
+        return function_(closure, context);
+    }
+
+    runtime::Method MakeMethod(std::string name, std::vector<std::string> formal_params,
+                               MethodFunction function, bool pure) {
+        runtime::Method method;
+        method.name = std::move(name);
+        method.formal_params = std::move(formal_params);
+        method.body = make_unique<NativeBody>(function);
+        method.pure = pure;
+
+        return method;
+    }
+
+    const runtime::Class& AsClass(const ObjectHolder& cls) {
+        return *cls.TryAs<runtime::Class>();
+    }
+
+    Variable::Variable(Closure& closure, const std::string& name)
+        : value_(closure.at(name))
+        , bound_(true) {
+    }
+
+    ObjectHolder ReadField(const ObjectHolder& object, const std::string& field) {
+        auto* instance = object.TryAs<ClassInstance>();
+
+        if (instance == nullptr) {
+            return object;
+        }
+
+        auto it = instance->Fields().find(field);
+
+        if (it == instance->Fields().end()) {
+            throw std::runtime_error("var is not found");
+        }
+
+        return it->second;
+    }
+
+    const ObjectHolder& AssignField(const ObjectHolder& object, const std::string& field, ObjectHolder value) {
+        auto* instance = object.TryAs<ClassInstance>();
+
+        if (instance == nullptr) {
+            throw std::runtime_error("field "s + field + " is assigned for non-object"s);
+        }
+
+        auto& slot = instance->Fields()[field];
+        slot = std::move(value);
+
+        return slot;
+    }
+
+    ObjectHolder MakeNumber(std::int64_t value) {
+        return ObjectHolder::Own(runtime::Number{ value });
+    }
+
+    ObjectHolder MakeString(std::string value) {
+        return ObjectHolder::Own(runtime::String{ std::move(value) });
+    }
+
+    ObjectHolder MakeBool(bool value) {
+        return ObjectHolder::Own(runtime::Bool{ value });
+    }
+
+    ObjectHolder Add(const ObjectHolder& lhs, const ObjectHolder& rhs, Context& context) {
+        auto* lhs_number = lhs.TryAs<runtime::Number>();
+        auto* rhs_number = rhs.TryAs<runtime::Number>();
+
+        if (lhs_number != nullptr && rhs_number != nullptr) {
+            std::int64_t result;
+
+            if (!__builtin_add_overflow(lhs_number->GetValue(), rhs_number->GetValue(), &result)) {
+                return MakeNumber(result);
+            }
+        }
+
+        auto* lhs_string = lhs.TryAs<runtime::String>();
+        auto* rhs_string = rhs.TryAs<runtime::String>();
+
+        if (lhs_string != nullptr && rhs_string != nullptr) {
+            return runtime::String::Concat(lhs, rhs);
+        }
+
+        if (auto result = runtime::ApplyBigArithmetic(runtime::ArithmeticOp::Add, lhs, rhs)) {
+            return result;
+        }
+
+        if (auto* instance = lhs.TryAs<ClassInstance>()) {
+            constexpr int ADD_METHOD_ARGS_COUNT = 1;
+
+            if (instance->HasMethod(ADD_METHOD, ADD_METHOD_ARGS_COUNT)) {
+                return instance->Call(ADD_METHOD, { rhs }, context);
+            }
+        }
+
+        throw std::runtime_error("incorrect add operands"s);
+    }
+
+    ObjectHolder Sub(const ObjectHolder& lhs, const ObjectHolder& rhs) {
+        auto* lhs_number = lhs.TryAs<runtime::Number>();
+        auto* rhs_number = rhs.TryAs<runtime::Number>();
+
+        if (lhs_number != nullptr && rhs_number != nullptr) {
+            std::int64_t result;
+
+            if (!__builtin_sub_overflow(lhs_number->GetValue(), rhs_number->GetValue(), &result)) {
+                return MakeNumber(result);
+            }
+        }
+
+        if (auto result = runtime::ApplyBigArithmetic(runtime::ArithmeticOp::Sub, lhs, rhs)) {
+            return result;
+        }
+
+        throw std::runtime_error("incorrect sub operands"s);
+    }
+
+    ObjectHolder Mult(const ObjectHolder& lhs, const ObjectHolder& rhs) {
+        auto* lhs_number = lhs.TryAs<runtime::Number>();
+        auto* rhs_number = rhs.TryAs<runtime::Number>();
+
+        if (lhs_number != nullptr && rhs_number != nullptr) {
+            std::int64_t result;
+
+            if (!__builtin_mul_overflow(lhs_number->GetValue(), rhs_number->GetValue(), &result)) {
+                return MakeNumber(result);
+            }
+        }
+
+        if (auto result = runtime::ApplyBigArithmetic(runtime::ArithmeticOp::Mult, lhs, rhs)) {
+            return result;
+        }
+
+        throw std::runtime_error("incorrect mult operands"s);
+    }
+
+    ObjectHolder Div(const ObjectHolder& lhs, const ObjectHolder& rhs) {
+        auto* lhs_number = lhs.TryAs<runtime::Number>();
+        auto* rhs_number = rhs.TryAs<runtime::Number>();
+
+        if (lhs_number != nullptr && rhs_number != nullptr) {
+            if (rhs_number->GetValue() == 0) {
+                throw std::runtime_error("division by zero"s);
+            }
+
+            if (lhs_number->GetValue() != INT64_MIN || rhs_number->GetValue() != -1) {
+                return MakeNumber(lhs_number->GetValue() / rhs_number->GetValue());
+            }
+        }
+
+        if (auto result = runtime::ApplyBigArithmetic(runtime::ArithmeticOp::Div, lhs, rhs)) {
+            return result;
+        }
+
+        throw std::runtime_error("incorrect div operands"s);
+    }
+
+    ObjectHolder Stringify(const ObjectHolder& object, Context& context) {
+        if (!object) {
+            return MakeString("None"s);
+        }
+
+        runtime::DummyContext dummy_context;
+        dummy_context.SetCallStack(context.GetCallStack());
+        dummy_context.SetMemoCache(context.GetMemoCache());
+
+        object->Print(dummy_context.GetOutputStream(), dummy_context);
+
+        return MakeString(dummy_context.output.str());
+    }
+
+    void PrintValue(std::ostream& os, const ObjectHolder& object, Context& context) {
+        if (object) {
+            object->Print(os, context);
+        } else {
+            os << "None"sv;
+        }
+    }
+
+    ClassInstance& Receiver(const ObjectHolder& object, const std::string& method) {
+        auto* instance = object.TryAs<ClassInstance>();
+
+        if (instance == nullptr) {
+            throw std::runtime_error("method "s + method + " is called for non-object"s);
+        }
+
+        return *instance;
+    }
+
+    CallSite::CallSite(const std::string& method)
+        : method_(method) {
+    }
+
+    ObjectHolder CallSite::Call(ClassInstance& receiver, const std::vector<ObjectHolder>& args, Context& context) {
+        const runtime::Class* cls = &receiver.GetClass();
+
+        if (cls != cls_) {
+            const auto* method = cls->GetMethod(method_);
+
+            if (method == nullptr || method->formal_params.size() != args.size()) {
+                throw std::runtime_error("No method found");
+            }
+
+            cls_ = cls;
+            resolved_ = method;
+        }
+
+        return receiver.Call(*resolved_, args, context);
+    }
+
+    ObjectHolder NewInstance(const runtime::Class& cls, const std::vector<ObjectHolder>& args, Context& context) {
+        auto instance = ObjectHolder::Own(ClassInstance(cls));
+        auto& class_inst = *instance.TryAs<ClassInstance>();
+
+        if (class_inst.HasMethod(INIT_METHOD, args.size())) {
+            class_inst.Call(INIT_METHOD, args, context);
+        }
+
+        return instance;
+    }
+
+    int Run(ProgramFunction program) {
+        try {
+            runtime::CallStack call_stack;
+            runtime::SimpleContext context{ cout };
+            context.SetCallStack(&call_stack);
+
+            runtime::MemoCache memo_cache;
+            if (std::getenv("MYTHON_NO_MEMO") == nullptr) {
+                context.SetMemoCache(&memo_cache);
+            }
+
+            runtime::GarbageCollector collector;
+
+            call_stack.Run([&] {
+                program(context);
+            });
+        } catch (const std::exception& e) {
+            std::cerr << e.what() << std::endl;
+            return 1;
+        }
+
+        return 0;
+    }
+
+} // namespace aot
@@ -0,0 +1,109 @@
+#pragma once
+
+#include "runtime.h"
+
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Runtime support of the C++ programs written by transpile::EmitCpp. A generated program is
+// compiled together with aot.cpp, runtime.cpp and bigint.cpp. Operations keep the semantics and
+// the error messages of the ast nodes they are emitted for
+namespace aot {
+
+    using MethodFunction = runtime::ObjectHolder (*)(runtime::Closure& closure, runtime::Context& context);
+
+    // Method body calling a generated function, the closure holds self and the parameters
+    class NativeBody : public runtime::Executable {
+    public:
+        explicit NativeBody(MethodFunction function);
+
+        runtime::ObjectHolder Execute(runtime::Closure& closure, runtime::Context& context) override;
+
+    private:
+        MethodFunction function_;
+    };
+
+    runtime::Method MakeMethod(std::string name, std::vector<std::string> formal_params,
+                               MethodFunction function, bool pure);
+
+    const runtime::Class& AsClass(const runtime::ObjectHolder& cls);
+
+    // Variable of a generated function. Reading it before the first assignment is an error,
+    // as a lookup of a missing name in the closure
+    class Variable {
+    public:
+        Variable() = default;
+
+        // self or a parameter from the method closure
+        Variable(runtime::Closure& closure, const std::string& name);
+
+        const runtime::ObjectHolder& Get() const {
+            if (!bound_) {
+                throw std::runtime_error("var is not found");
+            }
+            return value_;
+        }
+
+        const runtime::ObjectHolder& Set(runtime::ObjectHolder value) {
+            value_ = std::move(value);
+            bound_ = true;
+            return value_;
+        }
+
+    private:
+        runtime::ObjectHolder value_;
+        bool bound_ = false;
+    };
+
+    // Next id of a dotted path. The lookup stops at a value that is not an instance
+    runtime::ObjectHolder ReadField(const runtime::ObjectHolder& object, const std::string& field);
+
+    const runtime::ObjectHolder& AssignField(const runtime::ObjectHolder& object, const std::string& field,
+                                             runtime::ObjectHolder value);
+
+    runtime::ObjectHolder MakeNumber(std::int64_t value);
+    runtime::ObjectHolder MakeString(std::string value);
+    runtime::ObjectHolder MakeBool(bool value);
+
+    runtime::ObjectHolder Add(const runtime::ObjectHolder& lhs, const runtime::ObjectHolder& rhs,
+                              runtime::Context& context);
+    runtime::ObjectHolder Sub(const runtime::ObjectHolder& lhs, const runtime::ObjectHolder& rhs);
+    runtime::ObjectHolder Mult(const runtime::ObjectHolder& lhs, const runtime::ObjectHolder& rhs);
+    runtime::ObjectHolder Div(const runtime::ObjectHolder& lhs, const runtime::ObjectHolder& rhs);
+
+    // str(object)
+    runtime::ObjectHolder Stringify(const runtime::ObjectHolder& object, runtime::Context& context);
+
+    // One argument of print, None is printed as is
+    void PrintValue(std::ostream& os, const runtime::ObjectHolder& object, runtime::Context& context);
+
+    // Receiver of a method call, throws if the object is not an instance
+    runtime::ClassInstance& Receiver(const runtime::ObjectHolder& object, const std::string& method);
+
+    // Method call site, remembers the method resolved for the last receiver class
+    class CallSite {
+    public:
+        explicit CallSite(const std::string& method);
+
+        runtime::ObjectHolder Call(runtime::ClassInstance& receiver, const std::vector<runtime::ObjectHolder>& args,
+                                   runtime::Context& context);
+
+    private:
+        const std::string& method_;
+        const runtime::Class* cls_ = nullptr;
+        const runtime::Method* resolved_ = nullptr;
+    };
+
+    // New instance of the class, initialized by __init__ if the class has one for the arguments
+    runtime::ObjectHolder NewInstance(const runtime::Class& cls, const std::vector<runtime::ObjectHolder>& args,
+                                      runtime::Context& context);
+
+    using ProgramFunction = void (*)(runtime::Context& context);
+
+    // Runs the program as the interpreter does: output goes to stdout, calls keep their frames in
+    // a call stack, pure methods are memoized unless MYTHON_NO_MEMO is set. Returns the exit code
+    int Run(ProgramFunction program);
+
+} // namespace aot
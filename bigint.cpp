@@ -0,0 +1,377 @@
+#include "bigint.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+using namespace std;
+
+namespace bigint {
+
+    namespace {
+        using Limbs = vector<uint32_t>;
+
+        constexpr uint64_t LIMB_BASE = uint64_t{ 1 } << 32;
+
+        void Trim(Limbs& limbs) {
+            while (!limbs.empty() && limbs.back() == 0) {
+                limbs.pop_back();
+            }
+        }
+
+        int CompareMagnitudes(const Limbs& lhs, const Limbs& rhs) {
+            if (lhs.size() != rhs.size()) {
+                return lhs.size() < rhs.size() ? -1 : 1;
+            }
+
+            for (size_t i = lhs.size(); i-- > 0;) {
+                if (lhs[i] != rhs[i]) {
+                    return lhs[i] < rhs[i] ? -1 : 1;
+                }
+            }
+
+            return 0;
+        }
+
+        Limbs AddMagnitudes(const Limbs& lhs, const Limbs& rhs) {
+            const Limbs& longer = lhs.size() >= rhs.size() ? lhs : rhs;
+            const Limbs& shorter = lhs.size() >= rhs.size() ? rhs : lhs;
+
+            Limbs result(longer.size() + 1);
+            uint64_t carry = 0;
+
+            for (size_t i = 0; i < longer.size(); ++i) {
+                uint64_t sum = uint64_t{ longer[i] } + (i < shorter.size() ? shorter[i] : 0) + carry;
+                result[i] = static_cast<uint32_t>(sum);
+                carry = sum >> 32;
+            }
+            result[longer.size()] = static_cast<uint32_t>(carry);
+
+            Trim(result);
+            return result;
+        }
+
+        // lhs must not be less than rhs
+        Limbs SubtractMagnitudes(const Limbs& lhs, const Limbs& rhs) {
+            Limbs result(lhs.size());
+            int64_t borrow = 0;
+
+            for (size_t i = 0; i < lhs.size(); ++i) {
+                int64_t difference = int64_t{ lhs[i] } - (i < rhs.size() ? rhs[i] : 0) - borrow;
+                borrow = difference < 0 ? 1 : 0;
+                result[i] = static_cast<uint32_t>(difference + (borrow != 0 ? static_cast<int64_t>(LIMB_BASE) : 0));
+            }
+
+            Trim(result);
+            return result;
+        }
+
+        Limbs MultiplySchoolbook(const Limbs& lhs, const Limbs& rhs) {
+            if (lhs.empty() || rhs.empty()) {
+                return {};
+            }
+
+            Limbs result(lhs.size() + rhs.size());
+
+            for (size_t i = 0; i < lhs.size(); ++i) {
+                uint64_t carry = 0;
+
+                for (size_t j = 0; j < rhs.size(); ++j) {
+                    uint64_t product = uint64_t{ lhs[i] } * rhs[j] + result[i + j] + carry;
+                    result[i + j] = static_cast<uint32_t>(product);
+                    carry = product >> 32;
+                }
+                result[i + rhs.size()] = static_cast<uint32_t>(carry);
+            }
+
+            Trim(result);
+            return result;
+        }
+
+        // target += addend * base^shift
+        void AddShifted(Limbs& target, const Limbs& addend, size_t shift) {
+            if (target.size() < addend.size() + shift + 1) {
+                target.resize(addend.size() + shift + 1);
+            }
+
+            uint64_t carry = 0;
+            size_t i = 0;
+
+            for (; i < addend.size(); ++i) {
+                uint64_t sum = uint64_t{ target[i + shift] } + addend[i] + carry;
+                target[i + shift] = static_cast<uint32_t>(sum);
+                carry = sum >> 32;
+            }
+            for (; carry != 0; ++i) {
+                if (i + shift == target.size()) {
+                    target.push_back(0);
+                }
+                uint64_t sum = uint64_t{ target[i + shift] } + carry;
+                target[i + shift] = static_cast<uint32_t>(sum);
+                carry = sum >> 32;
+            }
+        }
+
+        Limbs Low(const Limbs& limbs, size_t count) {
+            Limbs result(limbs.begin(), limbs.begin() + static_cast<ptrdiff_t>(min(count, limbs.size())));
+            Trim(result);
+            return result;
+        }
+
+        Limbs High(const Limbs& limbs, size_t count) {
+            if (limbs.size() <= count) {
+                return {};
+            }
+            return Limbs(limbs.begin() + static_cast<ptrdiff_t>(count), limbs.end());
+        }
+
+        // x * y = z2 * base^2m + ((x0 + x1)(y0 + y1) - z2 - z0) * base^m + z0, where x = x1 * base^m + x0
+        Limbs MultiplyKaratsuba(const Limbs& lhs, const Limbs& rhs) {
+            if (min(lhs.size(), rhs.size()) < BigInt::KARATSUBA_THRESHOLD) {
+                return MultiplySchoolbook(lhs, rhs);
+            }
+
+            const size_t half = max(lhs.size(), rhs.size()) / 2;
+
+            Limbs lhs_low = Low(lhs, half);
+            Limbs lhs_high = High(lhs, half);
+            Limbs rhs_low = Low(rhs, half);
+            Limbs rhs_high = High(rhs, half);
+
+            Limbs low = MultiplyKaratsuba(lhs_low, rhs_low);
+            Limbs high = MultiplyKaratsuba(lhs_high, rhs_high);
+            Limbs middle = MultiplyKaratsuba(AddMagnitudes(lhs_low, lhs_high), AddMagnitudes(rhs_low, rhs_high));
+            middle = SubtractMagnitudes(SubtractMagnitudes(middle, low), high);
+
+            Limbs result = low;
+            AddShifted(result, middle, half);
+            AddShifted(result, high, 2 * half);
+
+            Trim(result);
+            return result;
+        }
+
+        Limbs DivideBySmall(const Limbs& dividend, uint32_t divisor, uint32_t& remainder) {
+            Limbs quotient(dividend.size());
+            uint64_t rest = 0;
+
+            for (size_t i = dividend.size(); i-- > 0;) {
+                uint64_t current = (rest << 32) | dividend[i];
+                quotient[i] = static_cast<uint32_t>(current / divisor);
+                rest = current % divisor;
+            }
+
+            remainder = static_cast<uint32_t>(rest);
+            Trim(quotient);
+            return quotient;
+        }
+
+        // Knuth, TAOCP vol. 2, 4.3.1, algorithm D. The divisor has at least two limbs and isn't
+        // greater than the dividend
+        Limbs DivideKnuth(const Limbs& dividend, const Limbs& divisor) {
+            const size_t n = divisor.size();
+            const size_t m = dividend.size() - n;
+            const int shift = __builtin_clz(divisor.back());
+
+            // normalized so the top bit of the divisor is set
+            Limbs v(n);
+            Limbs u(dividend.size() + 1);
+
+            for (size_t i = n; i-- > 1;) {
+                v[i] = shift == 0 ? divisor[i] : (divisor[i] << shift) | (divisor[i - 1] >> (32 - shift));
+            }
+            v[0] = divisor[0] << shift;
+
+            u[m + n] = shift == 0 ? 0 : dividend[m + n - 1] >> (32 - shift);
+            for (size_t i = m + n; i-- > 1;) {
+                u[i] = shift == 0 ? dividend[i] : (dividend[i] << shift) | (dividend[i - 1] >> (32 - shift));
+            }
+            u[0] = dividend[0] << shift;
+
+            Limbs quotient(m + 1);
+
+            for (size_t j = m + 1; j-- > 0;) {
+                const uint64_t numerator = (uint64_t{ u[j + n] } << 32) | u[j + n - 1];
+                uint64_t qhat = numerator / v[n - 1];
+                uint64_t rhat = numerator % v[n - 1];
+
+                while (qhat >= LIMB_BASE || qhat * v[n - 2] > ((rhat << 32) | u[j + n - 2])) {
+                    --qhat;
+                    rhat += v[n - 1];
+                    if (rhat >= LIMB_BASE) {
+                        break;
+                    }
+                }
+
+                // u[j .. j + n] -= qhat * v
+                int64_t borrow = 0;
+                int64_t difference;
+                for (size_t i = 0; i < n; ++i) {
+                    const uint64_t product = qhat * v[i];
+                    difference = int64_t{ u[i + j] } - borrow - static_cast<int64_t>(product & 0xFFFFFFFFU);
+                    u[i + j] = static_cast<uint32_t>(difference);
+                    borrow = static_cast<int64_t>(product >> 32) - (difference >> 32);
+                }
+                difference = int64_t{ u[j + n] } - borrow;
+                u[j + n] = static_cast<uint32_t>(difference);
+
+                quotient[j] = static_cast<uint32_t>(qhat);
+
+                // qhat was one too large, add the divisor back
+                if (difference < 0) {
+                    --quotient[j];
+                    uint64_t carry = 0;
+                    for (size_t i = 0; i < n; ++i) {
+                        uint64_t sum = uint64_t{ u[i + j] } + v[i] + carry;
+                        u[i + j] = static_cast<uint32_t>(sum);
+                        carry = sum >> 32;
+                    }
+                    u[j + n] = static_cast<uint32_t>(u[j + n] + carry);
+                }
+            }
+
+            Trim(quotient);
+            return quotient;
+        }
+
+        Limbs DivideMagnitudes(const Limbs& dividend, const Limbs& divisor) {
+            if (CompareMagnitudes(dividend, divisor) < 0) {
+                return {};
+            }
+
+            if (divisor.size() == 1) {
+                uint32_t remainder;
+                return DivideBySmall(dividend, divisor[0], remainder);
+            }
+
+            return DivideKnuth(dividend, divisor);
+        }
+    } // namespace
+
+    BigInt::BigInt(std::int64_t value)
+        : negative_(value < 0) {
+        // -(value + 1) + 1 doesn't overflow for the minimum value
+        uint64_t magnitude = negative_ ? static_cast<uint64_t>(-(value + 1)) + 1 : static_cast<uint64_t>(value);
+
+        while (magnitude != 0) {
+            magnitude_.push_back(static_cast<uint32_t>(magnitude));
+            magnitude >>= 32;
+        }
+    }
+
+    BigInt::BigInt(bool negative, Limbs magnitude)
+        : negative_(negative)
+        , magnitude_(std::move(magnitude)) {
+        Trim(magnitude_);
+        if (magnitude_.empty()) {
+            negative_ = false;
+        }
+    }
+
+    bool BigInt::IsZero() const {
+        return magnitude_.empty();
+    }
+
+    bool BigInt::IsNegative() const {
+        return negative_;
+    }
+
+    std::optional<std::int64_t> BigInt::ToInt64() const {
+        if (magnitude_.size() > 2) {
+            return nullopt;
+        }
+
+        uint64_t magnitude = 0;
+        for (size_t i = magnitude_.size(); i-- > 0;) {
+            magnitude = (magnitude << 32) | magnitude_[i];
+        }
+
+        constexpr uint64_t MAX_POSITIVE = static_cast<uint64_t>(INT64_MAX);
+
+        if (!negative_) {
+            if (magnitude > MAX_POSITIVE) {
+                return nullopt;
+            }
+            return static_cast<int64_t>(magnitude);
+        }
+
+        if (magnitude > MAX_POSITIVE + 1) {
+            return nullopt;
+        }
+        // -(magnitude - 1) - 1 doesn't overflow for the minimum value
+        return -static_cast<int64_t>(magnitude - 1) - 1;
+    }
+
+    std::string BigInt::ToString() const {
+        if (magnitude_.empty()) {
+            return "0"s;
+        }
+
+        // nine decimal digits at a time, the lowest first
+        constexpr uint32_t CHUNK = 1'000'000'000;
+        vector<uint32_t> chunks;
+        Limbs rest = magnitude_;
+
+        while (!rest.empty()) {
+            uint32_t chunk;
+            rest = DivideBySmall(rest, CHUNK, chunk);
+            chunks.push_back(chunk);
+        }
+
+        string result = negative_ ? "-"s : ""s;
+        result += to_string(chunks.back());
+
+        for (size_t i = chunks.size() - 1; i-- > 0;) {
+            string digits = to_string(chunks[i]);
+            result.append(9 - digits.size(), '0');
+            result += digits;
+        }
+
+        return result;
+    }
+
+    BigInt BigInt::operator-() const {
+        return BigInt(!negative_, magnitude_);
+    }
+
+    BigInt operator+(const BigInt& lhs, const BigInt& rhs) {
+        if (lhs.negative_ == rhs.negative_) {
+            return BigInt(lhs.negative_, AddMagnitudes(lhs.magnitude_, rhs.magnitude_));
+        }
+
+        // the sign of the operand with the larger magnitude
+        if (CompareMagnitudes(lhs.magnitude_, rhs.magnitude_) >= 0) {
+            return BigInt(lhs.negative_, SubtractMagnitudes(lhs.magnitude_, rhs.magnitude_));
+        }
+        return BigInt(rhs.negative_, SubtractMagnitudes(rhs.magnitude_, lhs.magnitude_));
+    }
+
+    BigInt operator-(const BigInt& lhs, const BigInt& rhs) {
+        return lhs + -rhs;
+    }
+
+    BigInt operator*(const BigInt& lhs, const BigInt& rhs) {
+        return BigInt(lhs.negative_ != rhs.negative_, MultiplyKaratsuba(lhs.magnitude_, rhs.magnitude_));
+    }
+
+    BigInt operator/(const BigInt& lhs, const BigInt& rhs) {
+        if (rhs.IsZero()) {
+            throw std::runtime_error("division by zero"s);
+        }
+
+        return BigInt(lhs.negative_ != rhs.negative_, DivideMagnitudes(lhs.magnitude_, rhs.magnitude_));
+    }
+
+    bool operator==(const BigInt& lhs, const BigInt& rhs) {
+        return lhs.negative_ == rhs.negative_ && lhs.magnitude_ == rhs.magnitude_;
+    }
+
+    bool operator<(const BigInt& lhs, const BigInt& rhs) {
+        if (lhs.negative_ != rhs.negative_) {
+            return lhs.negative_;
+        }
+
+        const int order = CompareMagnitudes(lhs.magnitude_, rhs.magnitude_);
+        return lhs.negative_ ? order > 0 : order < 0;
+    }
+
+} // namespace bigint
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace bigint {
+
+    // Integer of arbitrary precision in sign and magnitude form. The magnitude is kept in base 2^32
+    // limbs, the least significant first, without leading zero limbs (zero has no limbs). Long
+    // operands are multiplied by the Karatsuba method, short ones by the schoolbook method
+    class BigInt {
+    public:
+        // both operands of a product need at least this many limbs for Karatsuba
+        static constexpr size_t KARATSUBA_THRESHOLD = 32;
+
+        BigInt() = default;
+        BigInt(std::int64_t value);
+
+        bool IsZero() const;
+        bool IsNegative() const;
+
+        // nullopt if the value is out of the range of int64_t
+        std::optional<std::int64_t> ToInt64() const;
+
+        // decimal
+        std::string ToString() const;
+
+        BigInt operator-() const;
+
+        friend BigInt operator+(const BigInt& lhs, const BigInt& rhs);
+        friend BigInt operator-(const BigInt& lhs, const BigInt& rhs);
+        friend BigInt operator*(const BigInt& lhs, const BigInt& rhs);
+        // truncated toward zero as the division of int64_t, throws std::runtime_error if rhs is zero
+        friend BigInt operator/(const BigInt& lhs, const BigInt& rhs);
+
+        friend bool operator==(const BigInt& lhs, const BigInt& rhs);
+        friend bool operator<(const BigInt& lhs, const BigInt& rhs);
+
+    private:
+        using Limbs = std::vector<std::uint32_t>;
+
+        BigInt(bool negative, Limbs magnitude);
+
+        bool negative_ = false;
+        Limbs magnitude_;
+    };
+
+    inline bool operator!=(const BigInt& lhs, const BigInt& rhs) {
+        return !(lhs == rhs);
+    }
+
+} // namespace bigint
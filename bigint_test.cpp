@@ -0,0 +1,99 @@
+#include "bigint.h"
+#include "test_runner_p.h"
+
+#include <stdexcept>
+
+using namespace std;
+
+namespace bigint {
+
+    namespace {
+        BigInt Power(const BigInt& base, int exponent) {
+            BigInt result(1);
+            for (int i = 0; i < exponent; ++i) {
+                result = result * base;
+            }
+            return result;
+        }
+
+        void TestSmallValues() {
+            const int64_t values[] = { 0, 1, -1, 7, -7, 4'294'967'295, 4'294'967'296, -4'294'967'297,
+                                       1'000'000'007, INT32_MIN, INT64_MAX / 3, INT64_MIN / 5 };
+
+            for (int64_t lhs : values) {
+                for (int64_t rhs : values) {
+                    ASSERT_EQUAL((BigInt(lhs) + BigInt(rhs)).ToString(), BigInt(lhs + rhs).ToString());
+                    ASSERT_EQUAL(*(BigInt(lhs) - BigInt(rhs)).ToInt64(), lhs - rhs);
+                    ASSERT_EQUAL(BigInt(lhs) < BigInt(rhs), lhs < rhs);
+                    ASSERT_EQUAL(BigInt(lhs) == BigInt(rhs), lhs == rhs);
+
+                    if (rhs != 0) {
+                        ASSERT_EQUAL(*(BigInt(lhs) / BigInt(rhs)).ToInt64(), lhs / rhs);
+                    }
+                }
+            }
+
+            ASSERT_EQUAL((BigInt(-6) * BigInt(7)).ToString(), "-42"s);
+            ASSERT_EQUAL(BigInt(INT64_MIN).ToString(), "-9223372036854775808"s);
+            ASSERT_EQUAL(*BigInt(INT64_MIN).ToInt64(), INT64_MIN);
+            ASSERT(!(-BigInt(INT64_MIN)).ToInt64());
+            ASSERT((BigInt(5) - BigInt(5)).IsZero());
+            ASSERT(!(-BigInt(0)).IsNegative());
+            ASSERT_THROWS(BigInt(1) / BigInt(0), std::runtime_error);
+        }
+
+        void TestLargeValues() {
+            ASSERT_EQUAL(Power(BigInt(2), 100).ToString(), "1267650600228229401496703205376"s);
+            ASSERT_EQUAL((Power(BigInt(-3), 41) + BigInt(1)).ToString(), "-36472996377170786402"s);
+            ASSERT(BigInt(INT64_MAX) * BigInt(INT64_MAX) / BigInt(INT64_MAX) == BigInt(INT64_MAX));
+            ASSERT(Power(BigInt(10), 30) < Power(BigInt(10), 31));
+            ASSERT(-Power(BigInt(10), 31) < -Power(BigInt(10), 30));
+        }
+
+        // products of operands longer than the threshold go through Karatsuba
+        void TestKaratsuba() {
+            const BigInt ten_to_400 = Power(BigInt(10), 400);
+            ASSERT_EQUAL((ten_to_400 * ten_to_400).ToString(), "1"s + string(800, '0'));
+
+            const BigInt lhs = Power(BigInt(1'000'003), 300) + BigInt(12345);
+            const BigInt rhs = Power(BigInt(999'983), 250) - BigInt(1);
+            const BigInt product = lhs * rhs;
+
+            // the same product by single limb factors, which are multiplied by the schoolbook method
+            BigInt expected = lhs;
+            for (int i = 0; i < 250; ++i) {
+                expected = expected * BigInt(999'983);
+            }
+            ASSERT(product == expected - lhs);
+
+            ASSERT(product / rhs == lhs);
+            ASSERT(product / lhs == rhs);
+        }
+
+        void TestDivision() {
+            const BigInt dividend = Power(BigInt(7), 200) + BigInt(123'456'789);
+            const BigInt divisors[] = { BigInt(3), Power(BigInt(2), 40) + BigInt(1), Power(BigInt(13), 50),
+                                        -Power(BigInt(10), 60), dividend };
+
+            for (const BigInt& divisor : divisors) {
+                const BigInt quotient = dividend / divisor;
+                const BigInt remainder = dividend - quotient * divisor;
+
+                // truncated: the remainder is smaller than the divisor and has the sign of the dividend
+                ASSERT(!remainder.IsNegative());
+                ASSERT(remainder < (divisor.IsNegative() ? -divisor : divisor));
+            }
+
+            ASSERT(-dividend / BigInt(3) == -(dividend / BigInt(3)));
+            ASSERT((BigInt(5) / dividend).IsZero());
+        }
+    } // namespace
+
+    void RunBigIntTests(TestRunner& tr) {
+        RUN_TEST(tr, bigint::TestSmallValues);
+        RUN_TEST(tr, bigint::TestLargeValues);
+        RUN_TEST(tr, bigint::TestKaratsuba);
+        RUN_TEST(tr, bigint::TestDivision);
+    }
+
+} // namespace bigint
@@ -0,0 +1,472 @@
+#include "jit.h"
+
+#include "statement.h"
+
+#include <cstdint>
+#include <cstring>
+
+#include <sys/mman.h>
+
+using namespace std;
+
+namespace jit {
+
+    // Executable memory for compiled code. It is writable only while new code is copied in
+    class CodeRegion {
+    public:
+        static constexpr size_t DEFAULT_SIZE = 64 * 1024;
+
+        explicit CodeRegion(size_t size = DEFAULT_SIZE)
+            : size_(size) {
+            void* memory = mmap(nullptr, size_, PROT_READ | PROT_EXEC, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            memory_ = memory == MAP_FAILED ? nullptr : static_cast<unsigned char*>(memory);
+        }
+
+        ~CodeRegion() {
+            if (memory_ != nullptr) {
+                munmap(memory_, size_);
+            }
+        }
+
+        CodeRegion(const CodeRegion&) = delete;
+        CodeRegion& operator=(const CodeRegion&) = delete;
+
+        // Returns null if the code doesn't fit or the memory can't be made writable
+        const void* Append(const vector<unsigned char>& code) {
+            if (memory_ == nullptr || size_ - used_ < code.size()) {
+                return nullptr;
+            }
+
+            if (mprotect(memory_, size_, PROT_READ | PROT_WRITE) != 0) {
+                return nullptr;
+            }
+
+            unsigned char* start = memory_ + used_;
+            memcpy(start, code.data(), code.size());
+
+            if (mprotect(memory_, size_, PROT_READ | PROT_EXEC) != 0) {
+                return nullptr;
+            }
+
+            // functions start at 16 byte boundaries
+            used_ += (code.size() + 15) / 16 * 16;
+            used_ = min(used_, size_);
+
+            return start;
+        }
+
+    private:
+        unsigned char* memory_ = nullptr;
+        size_t size_;
+        size_t used_ = 0;
+    };
+
+    namespace {
+        using ast::CompiledInt;
+        using ast::IntConst;
+        using ast::IntExpression;
+        using ast::IntOperation;
+        using ast::IntVariable;
+
+        // x86-64 templates of integer nodes. Compiled function (System V ABI):
+        //     int64_t f(const int64_t* inputs /* rdi */, int* error /* rsi */)
+        // A node leaves its value in rax, the right operand of an operator is in rcx. Values waiting
+        // for the right operand are pushed, the frame pointer restores the stack on all exits.
+        // Every operation checks the overflow flag, an overflow leaves through its own exit
+        class IntCompiler {
+        public:
+            bool CompileExpression(const IntExpression& expression) {
+                Prologue();
+
+                if (!Emit(expression)) {
+                    return false;
+                }
+
+                Finish();
+                return true;
+            }
+
+            template <typename Cmp>
+            bool CompileComparison(const IntExpression& lhs, const IntExpression& rhs) {
+                Prologue();
+
+                if (!EmitOperands(lhs, rhs)) {
+                    return false;
+                }
+
+                Bytes({ 0x48, 0x39, 0xC8 });                // cmp rax, rcx
+                Bytes({ 0x0F, ConditionCode(Cmp{}), 0xC0 }); // setcc al
+                Bytes({ 0x0F, 0xB6, 0xC0 });                // movzx eax, al
+
+                Finish();
+                return true;
+            }
+
+            const vector<unsigned char>& GetCode() const {
+                return code_;
+            }
+
+            vector<const IntVariable*> TakeInputs() {
+                return std::move(inputs_);
+            }
+
+        private:
+            static unsigned char ConditionCode(ast::compare::Equal) {
+                return 0x94; // sete
+            }
+
+            static unsigned char ConditionCode(ast::compare::NotEqual) {
+                return 0x95; // setne
+            }
+
+            static unsigned char ConditionCode(ast::compare::Less) {
+                return 0x9C; // setl
+            }
+
+            static unsigned char ConditionCode(ast::compare::Greater) {
+                return 0x9F; // setg
+            }
+
+            static unsigned char ConditionCode(ast::compare::LessOrEqual) {
+                return 0x9E; // setle
+            }
+
+            static unsigned char ConditionCode(ast::compare::GreaterOrEqual) {
+                return 0x9D; // setge
+            }
+
+            void Prologue() {
+                Bytes({ 0x55 });             // push rbp
+                Bytes({ 0x48, 0x89, 0xE5 }); // mov rbp, rsp
+            }
+
+            void Epilogue() {
+                Bytes({ 0x48, 0x89, 0xEC }); // mov rsp, rbp
+                Bytes({ 0x5D });             // pop rbp
+                Bytes({ 0xC3 });             // ret
+            }
+
+            // Normal exit, then the division by zero and the overflow exits the checks jump to
+            void Finish() {
+                Epilogue();
+                ErrorExit(error_jumps_, CompiledInt::ERROR_DIVISION_BY_ZERO);
+                ErrorExit(overflow_jumps_, CompiledInt::ERROR_OVERFLOW);
+            }
+
+            void ErrorExit(const vector<size_t>& jumps, int error) {
+                const size_t exit = code_.size();
+                for (size_t jump : jumps) {
+                    Patch32(jump, static_cast<int32_t>(exit - (jump + 4)));
+                }
+
+                Bytes({ 0xC7, 0x06 }); // mov dword [rsi], error
+                Imm32(error);
+                Bytes({ 0x31, 0xC0 }); // xor eax, eax
+                Epilogue();
+            }
+
+            void JumpOnOverflow() {
+                Bytes({ 0x0F, 0x80 }); // jo overflow
+                overflow_jumps_.push_back(code_.size());
+                Imm32(0);
+            }
+
+            // Input slot of the next variable, variables are read in evaluation order
+            bool AddInput(const IntVariable& var, int32_t& offset) {
+                if (inputs_.size() == CompiledInt::MAX_INPUTS) {
+                    return false;
+                }
+
+                offset = static_cast<int32_t>(inputs_.size() * sizeof(int64_t));
+                inputs_.push_back(&var);
+                return true;
+            }
+
+            // Constant or variable, loaded straight into the register (0 is rax, 1 is rcx)
+            bool EmitLeaf(const IntExpression& expression, unsigned char reg) {
+                if (const auto* constant = dynamic_cast<const IntConst*>(&expression)) {
+                    const int64_t value = constant->GetValue();
+
+                    if (value >= INT32_MIN && value <= INT32_MAX) {
+                        Bytes({ 0x48, 0xC7, static_cast<unsigned char>(0xC0 + reg) }); // mov reg, simm32
+                        Imm32(static_cast<int32_t>(value));
+                    } else {
+                        Bytes({ 0x48, static_cast<unsigned char>(0xB8 + reg) }); // mov reg, imm64
+                        Imm64(value);
+                    }
+                    return true;
+                }
+
+                if (const auto* var = dynamic_cast<const IntVariable*>(&expression)) {
+                    int32_t offset;
+                    if (!AddInput(*var, offset)) {
+                        return false;
+                    }
+
+                    Bytes({ 0x48, 0x8B, static_cast<unsigned char>(0x87 | (reg << 3)) }); // mov reg, [rdi + disp32]
+                    Imm32(offset);
+                    return true;
+                }
+
+                return false;
+            }
+
+            static bool IsLeaf(const IntExpression& expression) {
+                return dynamic_cast<const IntConst*>(&expression) != nullptr
+                       || dynamic_cast<const IntVariable*>(&expression) != nullptr;
+            }
+
+            // lhs into rax, rhs into rcx
+            bool EmitOperands(const IntExpression& lhs, const IntExpression& rhs) {
+                if (!Emit(lhs)) {
+                    return false;
+                }
+
+                if (IsLeaf(rhs)) {
+                    return EmitLeaf(rhs, 1);
+                }
+
+                Bytes({ 0x50 }); // push rax
+                if (!Emit(rhs)) {
+                    return false;
+                }
+                Bytes({ 0x48, 0x89, 0xC1 }); // mov rcx, rax
+                Bytes({ 0x58 });             // pop rax
+
+                return true;
+            }
+
+            template <typename Op>
+            const IntOperation<Op>* AsOperation(const IntExpression& expression) {
+                return dynamic_cast<const IntOperation<Op>*>(&expression);
+            }
+
+            bool Emit(const IntExpression& expression) {
+                if (IsLeaf(expression)) {
+                    return EmitLeaf(expression, 0);
+                }
+
+                if (const auto* add = AsOperation<ast::arithmetic::Add>(expression)) {
+                    if (!EmitOperands(add->GetLhs(), add->GetRhs())) {
+                        return false;
+                    }
+                    Bytes({ 0x48, 0x01, 0xC8 }); // add rax, rcx
+                    JumpOnOverflow();
+                    return true;
+                }
+
+                if (const auto* sub = AsOperation<ast::arithmetic::Sub>(expression)) {
+                    if (!EmitOperands(sub->GetLhs(), sub->GetRhs())) {
+                        return false;
+                    }
+                    Bytes({ 0x48, 0x29, 0xC8 }); // sub rax, rcx
+                    JumpOnOverflow();
+                    return true;
+                }
+
+                if (const auto* mult = AsOperation<ast::arithmetic::Mult>(expression)) {
+                    if (!EmitOperands(mult->GetLhs(), mult->GetRhs())) {
+                        return false;
+                    }
+                    Bytes({ 0x48, 0x0F, 0xAF, 0xC1 }); // imul rax, rcx
+                    JumpOnOverflow();
+                    return true;
+                }
+
+                if (const auto* div = AsOperation<ast::arithmetic::Div>(expression)) {
+                    if (!EmitOperands(div->GetLhs(), div->GetRhs())) {
+                        return false;
+                    }
+                    EmitDivision();
+                    return true;
+                }
+
+                return false;
+            }
+
+            // rax / rcx truncated toward zero. idiv traps on a zero divisor and on INT64_MIN / -1,
+            // so both are checked first: zero goes to the error exit, -1 negates and overflows on
+            // INT64_MIN
+            void EmitDivision() {
+                Bytes({ 0x48, 0x85, 0xC9 });       // test rcx, rcx
+                Bytes({ 0x0F, 0x84 });             // jz error
+                error_jumps_.push_back(code_.size());
+                Imm32(0);
+                Bytes({ 0x48, 0x83, 0xF9, 0xFF }); // cmp rcx, -1
+                Bytes({ 0x75, 0x0B });             // jne divide
+                Bytes({ 0x48, 0xF7, 0xD8 });       // neg rax
+                JumpOnOverflow();
+                Bytes({ 0xEB, 0x05 });             // jmp done
+                Bytes({ 0x48, 0x99 });             // divide: cqo
+                Bytes({ 0x48, 0xF7, 0xF9 });       // idiv rcx
+                                                   // done:
+            }
+
+            void Bytes(initializer_list<unsigned char> bytes) {
+                code_.insert(code_.end(), bytes);
+            }
+
+            void Imm32(int32_t value) {
+                const auto bits = static_cast<uint32_t>(value);
+                for (int shift = 0; shift < 32; shift += 8) {
+                    code_.push_back(static_cast<unsigned char>(bits >> shift));
+                }
+            }
+
+            void Imm64(int64_t value) {
+                const auto bits = static_cast<uint64_t>(value);
+                for (int shift = 0; shift < 64; shift += 8) {
+                    code_.push_back(static_cast<unsigned char>(bits >> shift));
+                }
+            }
+
+            void Patch32(size_t position, int32_t value) {
+                const auto bits = static_cast<uint32_t>(value);
+                for (int i = 0; i < 4; ++i) {
+                    code_[position + i] = static_cast<unsigned char>(bits >> (8 * i));
+                }
+            }
+
+            vector<unsigned char> code_;
+            // positions of rel32 operands of jumps to the division by zero exit
+            vector<size_t> error_jumps_;
+            // positions of rel32 operands of jumps to the overflow exit
+            vector<size_t> overflow_jumps_;
+            vector<const IntVariable*> inputs_;
+        };
+
+        template <typename Visitor>
+        void VisitNodes(unique_ptr<runtime::Executable>& node, Visitor& visitor) {
+            if (!node) {
+                return;
+            }
+
+            visitor(node.get());
+            node->ForEachChild([&visitor](unique_ptr<runtime::Executable>& child) {
+                VisitNodes(child, visitor);
+            });
+        }
+    } // namespace
+
+    Jit::Jit(Mode mode, size_t hot_calls)
+        : runtime::MethodCompiler(hot_calls)
+        , mode_(mode) {
+    }
+
+    Jit::~Jit() = default;
+
+    bool Jit::IsSupported() {
+#if defined(__x86_64__)
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    Jit::Mode Jit::GetMode() const {
+        return mode_;
+    }
+
+    size_t Jit::GetCompiledMethods() const {
+        return compiled_methods_;
+    }
+
+    size_t Jit::GetCompiledExpressions() const {
+        return compiled_expressions_;
+    }
+
+    shared_ptr<const void> Jit::Install(const vector<unsigned char>& code) {
+        if (code.size() > CodeRegion::DEFAULT_SIZE) {
+            return nullptr;
+        }
+
+        const void* start = region_ ? region_->Append(code) : nullptr;
+
+        if (start == nullptr) {
+            region_ = make_shared<CodeRegion>();
+            start = region_->Append(code);
+        }
+
+        if (start == nullptr) {
+            return nullptr;
+        }
+
+        // shares ownership of the whole region
+        return shared_ptr<const void>(region_, start);
+    }
+
+    void Jit::Compile(const runtime::Method& method) {
+        if (mode_ == Mode::Off || !IsSupported()) {
+            return;
+        }
+
+        size_t compiled = 0;
+
+        // Code and inputs of a compiled subtree, nullopt if it isn't covered by the templates
+        auto install = [this](IntCompiler& compiler) -> optional<CompiledInt> {
+            auto code = Install(compiler.GetCode());
+
+            if (!code) {
+                return nullopt;
+            }
+
+            CompiledInt result;
+            result.function = reinterpret_cast<CompiledInt::Function>(reinterpret_cast<uintptr_t>(code.get()));
+            result.inputs = compiler.TakeInputs();
+            result.code = std::move(code);
+            result.verify = mode_ == Mode::Differential;
+
+            return result;
+        };
+
+        auto compile_comparison = [&](runtime::Executable* node, auto cmp) {
+            using Cmp = decltype(cmp);
+
+            auto* comparison = dynamic_cast<ast::UnboxedComparison<Cmp>*>(node);
+            if (comparison == nullptr) {
+                return;
+            }
+
+            IntCompiler compiler;
+            if (!compiler.CompileComparison<Cmp>(comparison->GetLhs(), comparison->GetRhs())) {
+                return;
+            }
+
+            if (auto result = install(compiler)) {
+                comparison->SetCompiled(std::move(*result));
+                ++compiled;
+            }
+        };
+
+        auto visitor = [&](runtime::Executable* node) {
+            if (auto* unboxed = dynamic_cast<ast::UnboxedInt*>(node)) {
+                IntCompiler compiler;
+
+                if (compiler.CompileExpression(unboxed->GetExpression())) {
+                    if (auto result = install(compiler)) {
+                        unboxed->SetCompiled(std::move(*result));
+                        ++compiled;
+                    }
+                }
+                return;
+            }
+
+            compile_comparison(node, ast::compare::Equal{});
+            compile_comparison(node, ast::compare::NotEqual{});
+            compile_comparison(node, ast::compare::Less{});
+            compile_comparison(node, ast::compare::Greater{});
+            compile_comparison(node, ast::compare::LessOrEqual{});
+            compile_comparison(node, ast::compare::GreaterOrEqual{});
+        };
+
+        // the body is owned by the method, the compiler only fills in compiled code of its nodes
+        auto& body = const_cast<unique_ptr<runtime::Executable>&>(method.body);
+        VisitNodes(body, visitor);
+
+        if (compiled > 0) {
+            ++compiled_methods_;
+            compiled_expressions_ += compiled;
+        }
+    }
+
+} // namespace jit
@@ -0,0 +1,52 @@
+#pragma once
+
+#include "runtime.h"
+
+#include <memory>
+#include <vector>
+
+namespace jit {
+
+    class CodeRegion;
+
+    // Baseline JIT. When a method has been called hot_calls times, the integer subtrees of its body
+    // (ast::UnboxedInt and ast::UnboxedComparison, see optimize::InferTypes) get x86-64 machine
+    // code: every ast::IntExpression node is stitched from a fixed template, the result is left
+    // in eax. Everything else in the method stays interpreted, as do subtrees with more than
+    // ast::CompiledInt::MAX_INPUTS variables. On other platforms nothing is compiled
+    class Jit : public runtime::MethodCompiler {
+    public:
+        enum class Mode {
+            Off,          // kill switch, methods are only counted
+            On,           // compiled code replaces the interpreter
+            Differential, // compiled code runs and every result is checked against the interpreter
+        };
+
+        static constexpr size_t DEFAULT_HOT_CALLS = 100;
+
+        explicit Jit(Mode mode = Mode::On, size_t hot_calls = DEFAULT_HOT_CALLS);
+        ~Jit();
+
+        Jit(const Jit&) = delete;
+        Jit& operator=(const Jit&) = delete;
+
+        static bool IsSupported();
+
+        Mode GetMode() const;
+        size_t GetCompiledMethods() const;
+        size_t GetCompiledExpressions() const;
+
+    private:
+        void Compile(const runtime::Method& method) override;
+
+        // Copies the code to executable memory
+        std::shared_ptr<const void> Install(const std::vector<unsigned char>& code);
+
+        Mode mode_;
+        size_t compiled_methods_ = 0;
+        size_t compiled_expressions_ = 0;
+        // the last region has free space, compiled nodes share ownership of the regions
+        std::shared_ptr<CodeRegion> region_;
+    };
+
+} // namespace jit
@@ -0,0 +1,192 @@
+#include "jit.h"
+#include "lexer.h"
+#include "optimize.h"
+#include "parse.h"
+#include "statement.h"
+#include "test_runner_p.h"
+
+using namespace std;
+
+namespace jit {
+
+    namespace {
+        unique_ptr<ast::Statement> ParseOptimized(const string& program_text) {
+            istringstream is(program_text);
+            parse::Lexer lexer(is);
+
+            auto program = ParseProgram(lexer);
+            optimize::OptimizeProgram(program);
+
+            return program;
+        }
+
+        string RunProgram(ast::Statement& program, Jit* jit) {
+            runtime::DummyContext context;
+            context.SetMethodCompiler(jit);
+
+            runtime::Closure closure;
+            program.Execute(closure, context);
+
+            return context.output.str();
+        }
+
+        const string HOT_ARITHMETIC = R"(
+class Calc:
+  def mix(seed):
+    a = 7
+    b = 0 - 3
+    i = 0
+    total = 0
+    while i < 20:
+      total = total + a * i - b / 2 + (0 - i) / a
+      if i * 3 >= 30:
+        total = total - (i / a) * (b - a)
+      if i != 5:
+        total = total + 1
+      i = i + 1
+    return total + seed
+
+c = Calc()
+n = 0
+while n < 10:
+  print c.mix(n)
+  n = n + 1
+)"s;
+
+        // Compiled code checked against the interpreter on every evaluation
+        void TestDifferential() {
+            auto reference = ParseOptimized(HOT_ARITHMETIC);
+            const string expected = RunProgram(*reference, nullptr);
+
+            auto program = ParseOptimized(HOT_ARITHMETIC);
+            Jit jit(Jit::Mode::Differential, 2);
+            ASSERT_EQUAL(RunProgram(*program, &jit), expected);
+
+            if (Jit::IsSupported()) {
+                ASSERT_EQUAL(jit.GetCompiledMethods(), 1U);
+                ASSERT(jit.GetCompiledExpressions() >= 5U);
+            }
+
+            // the same tree again, compiled code replaces the interpreter
+            Jit fast(Jit::Mode::On, 1);
+            auto compiled = ParseOptimized(HOT_ARITHMETIC);
+            ASSERT_EQUAL(RunProgram(*compiled, &fast), expected);
+        }
+
+        void TestDivisionByZero() {
+            auto program = ParseOptimized(R"(
+class Ratio:
+  def __init__():
+    self.divisor = 3
+
+  def of(x):
+    y = 90
+    z = y / self.divisor + 1
+    return z * 2
+
+r = Ratio()
+print r.of(1), r.of(2), r.of(3)
+r.divisor = 0
+print r.of(4)
+)"s);
+
+            Jit jit(Jit::Mode::On, 2);
+            runtime::DummyContext context;
+            context.SetMethodCompiler(&jit);
+            runtime::Closure closure;
+
+            ASSERT_THROWS(program->Execute(closure, context), std::runtime_error);
+            ASSERT_EQUAL(context.output.str(), "62 62 62\n"s);
+            if (Jit::IsSupported()) {
+                ASSERT_EQUAL(jit.GetCompiledMethods(), 1U);
+            }
+        }
+
+        // compiled code leaves on overflow, the original expression promotes the result
+        void TestOverflow() {
+            const string program_text = R"(
+class Power:
+  def of(base, exponent):
+    result = 1
+    i = 0
+    while i < exponent:
+      result = result * base
+      i = i + 1
+    return result
+
+  def square(x):
+    return x * x + 1 > 0
+
+p = Power()
+print p.of(2, 10), p.of(2, 62), p.of(2, 63), p.of(0 - 2, 63), p.of(3, 50)
+print p.square(3), p.square(3037000500), p.square(9223372036854775807)
+)"s;
+
+            auto reference = ParseOptimized(program_text);
+            const string expected = RunProgram(*reference, nullptr);
+            ASSERT_EQUAL(expected, "1024 4611686018427387904 9223372036854775808 -9223372036854775808 "
+                                   "717897987691852588770249\nTrue True True\n"s);
+
+            auto program = ParseOptimized(program_text);
+            Jit jit(Jit::Mode::Differential, 1);
+            ASSERT_EQUAL(RunProgram(*program, &jit), expected);
+        }
+
+        // the typed copy of a lookup and its original share the slot of the common path, both
+        // read it when the copy leaves on overflow or the compiled code is checked
+        void TestCommonPaths() {
+            const string program_text = R"(
+class Node:
+  def __init__():
+    self.value = 0
+
+class Box:
+  def __init__(n):
+    self.node = n
+
+class Square:
+  def of(box):
+    a = box.node.value
+    return box.node.value * a
+
+n = Node()
+b = Box(n)
+s = Square()
+i = 0
+total = 0
+while i < 10:
+  n.value = i
+  total = total + s.of(b)
+  i = i + 1
+n.value = 3037000500
+print total, s.of(b)
+)"s;
+
+            auto reference = ParseOptimized(program_text);
+            const string expected = RunProgram(*reference, nullptr);
+            ASSERT_EQUAL(expected, "285 9223372037000250000\n"s);
+
+            auto program = ParseOptimized(program_text);
+            Jit jit(Jit::Mode::Differential, 1);
+            ASSERT_EQUAL(RunProgram(*program, &jit), expected);
+        }
+
+        void TestOff() {
+            auto program = ParseOptimized(HOT_ARITHMETIC);
+            Jit jit(Jit::Mode::Off, 1);
+            RunProgram(*program, &jit);
+
+            ASSERT_EQUAL(jit.GetCompiledMethods(), 0U);
+            ASSERT_EQUAL(jit.GetCompiledExpressions(), 0U);
+        }
+    } // namespace
+
+    void RunJitTests(TestRunner& tr) {
+        RUN_TEST(tr, jit::TestDifferential);
+        RUN_TEST(tr, jit::TestDivisionByZero);
+        RUN_TEST(tr, jit::TestOverflow);
+        RUN_TEST(tr, jit::TestCommonPaths);
+        RUN_TEST(tr, jit::TestOff);
+    }
+
+} // namespace jit
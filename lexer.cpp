@@ -71,6 +71,9 @@ namespace parse {
         UNVALUED_OUTPUT(None);
         UNVALUED_OUTPUT(True);
         UNVALUED_OUTPUT(False);
+        UNVALUED_OUTPUT(While);
+        UNVALUED_OUTPUT(Break);
+        UNVALUED_OUTPUT(Continue);
         UNVALUED_OUTPUT(Eof);
 
 #undef UNVALUED_OUTPUT
@@ -334,7 +337,12 @@ namespace parse {
                 }
             }
 
-            int num = std::stoi(parsed_num);
+            std::int64_t num;
+            auto [last, error] = std::from_chars(parsed_num.data(), parsed_num.data() + parsed_num.size(), num);
+
+            if (error != std::errc()) {
+                throw LexerError("Number "s + parsed_num + " is out of range"s);
+            }
 
             container.emplace_back(token_type::Number{ num });
         }
@@ -373,6 +381,9 @@ namespace parse {
         keywords_.emplace("not"sv, token_type::Not{});
         keywords_.emplace("True"sv, token_type::True{});
         keywords_.emplace("False"sv, token_type::False{});
+        keywords_.emplace("while"sv, token_type::While{});
+        keywords_.emplace("break"sv, token_type::Break{});
+        keywords_.emplace("continue"sv, token_type::Continue{});
     }
 
 } // namespace parse
\ No newline at end of file
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstdint>
 #include <iosfwd>
 #include <optional>
 #include <sstream>
@@ -12,8 +13,8 @@
 namespace parse {
 
     namespace token_type {
-        struct Number { // Лексема «число»
-            int value;  // число
+        struct Number {     // Лексема «число»
+            std::int64_t value; // число
         };
 
         struct Id {            // Лексема «идентификатор»
@@ -48,6 +49,9 @@ namespace parse {
         struct None {};        // Лексема «None»
         struct True {};        // Лексема «True»
         struct False {};       // Лексема «False»
+        struct While {};       // Лексема «while»
+        struct Break {};       // Лексема «break»
+        struct Continue {};    // Лексема «continue»
     }                          // namespace token_type
 
     using TokenBase
@@ -56,7 +60,8 @@ namespace parse {
                        token_type::Def, token_type::Newline, token_type::Print, token_type::Indent,
                        token_type::Dedent, token_type::And, token_type::Or, token_type::Not,
                        token_type::Eq, token_type::NotEq, token_type::LessOrEq, token_type::GreaterOrEq,
-                       token_type::None, token_type::True, token_type::False, token_type::Eof>;
+                       token_type::None, token_type::True, token_type::False, token_type::While,
+                       token_type::Break, token_type::Continue, token_type::Eof>;
 
     struct Token : TokenBase {
         using TokenBase::TokenBase;
@@ -49,6 +49,18 @@ namespace parse {
             ASSERT_EQUAL(lexer.NextToken(), Token(token_type::False{}));
         }
 
+        void TestLoopKeywords() {
+            istringstream input("while x: break continue whiles"s);
+            Lexer lexer(input);
+
+            ASSERT_EQUAL(lexer.CurrentToken(), Token(token_type::While{}));
+            ASSERT_EQUAL(lexer.NextToken(), Token(token_type::Id{ "x"s }));
+            ASSERT_EQUAL(lexer.NextToken(), Token(token_type::Char{ ':' }));
+            ASSERT_EQUAL(lexer.NextToken(), Token(token_type::Break{}));
+            ASSERT_EQUAL(lexer.NextToken(), Token(token_type::Continue{}));
+            ASSERT_EQUAL(lexer.NextToken(), Token(token_type::Id{ "whiles"s }));
+        }
+
         void TestNumbers() {
             istringstream input("42 15 -53"s);
             Lexer lexer(input);
@@ -365,6 +377,7 @@ abc#
     void RunOpenLexerTests(TestRunner& tr) {
         RUN_TEST(tr, parse::TestSimpleAssignment);
         RUN_TEST(tr, parse::TestKeywords);
+        RUN_TEST(tr, parse::TestLoopKeywords);
         RUN_TEST(tr, parse::TestNumbers);
         RUN_TEST(tr, parse::TestIds);
         RUN_TEST(tr, parse::TestStrings);
@@ -1,14 +1,23 @@
+#include "jit.h"
 #include "lexer.h"
+#include "optimize.h"
 #include "parse.h"
 #include "runtime.h"
 #include "statement.h"
 #include "test_runner_p.h"
+#include "transpile.h"
 
+#include <cstdlib>
 #include <fstream>
 #include <iostream>
+#include <optional>
 
 using namespace std;
 
+namespace bigint {
+    void RunBigIntTests(TestRunner& tr);
+}
+
 namespace parse {
     void RunOpenLexerTests(TestRunner& tr);
 } // namespace parse
@@ -22,16 +31,49 @@ namespace runtime {
     void RunUserTests(TestRunner& tr);
 } // namespace runtime
 
+namespace optimize {
+    void RunOptimizeTests(TestRunner& tr);
+}
+
+namespace jit {
+    void RunJitTests(TestRunner& tr);
+}
+
+namespace transpile {
+    void RunTranspileTests(TestRunner& tr);
+}
+
 void TestParseProgram(TestRunner& tr);
 
 void TestAll() {
     TestRunner tr;
+    bigint::RunBigIntTests(tr);
     parse::RunOpenLexerTests(tr);
     runtime::RunObjectHolderTests(tr);
     runtime::RunObjectsTests(tr);
     runtime::RunUserTests(tr);
     ast::RunUnitTests(tr);
     TestParseProgram(tr);
+    optimize::RunOptimizeTests(tr);
+    jit::RunJitTests(tr);
+    transpile::RunTranspileTests(tr);
+}
+
+// C++ translation unit running the program, see transpile::EmitCpp
+void EmitMythonProgramCpp(std::ostream& output) {
+    string filename = "../test.py"s;
+
+    ifstream in(filename);
+
+    if (!in.is_open()) {
+        return;
+    }
+
+    parse::Lexer lexer(in);
+    auto program = ParseProgram(lexer);
+    optimize::MarkPureMethods(program);
+
+    transpile::EmitCpp(program, output);
 }
 
 void LoadRunMythonProgram(std::istream& input, std::ostream& output) {
@@ -43,18 +85,84 @@ void LoadRunMythonProgram(std::istream& input, std::ostream& output) {
         return;
     }
 
+    // MYTHON_REGION takes the objects of the run from a region, the objects left in the end are
+    // dropped with it instead of being destroyed one by one. The region is made after parsing but
+    // declared before the tree: nodes may hold values of the run, the tree goes first
+    optional<runtime::Region> region;
+
     parse::Lexer lexer(in);
     auto program = ParseProgram(lexer);
+    optimize::OptimizeProgram(program);
+
+    if (std::getenv("MYTHON_REGION") != nullptr) {
+        region.emplace();
+    }
 
+    runtime::CallStack call_stack;
     runtime::SimpleContext context{ output };
+    context.SetCallStack(&call_stack);
+
+    // MYTHON_NO_MEMO turns off caching of pure method results
+    runtime::MemoCache memo_cache;
+    if (std::getenv("MYTHON_NO_MEMO") == nullptr) {
+        context.SetMemoCache(&memo_cache);
+    }
+
+    // MYTHON_JIT=off turns off compilation of hot methods, MYTHON_JIT=diff checks compiled code
+    // against the interpreter
+    jit::Jit::Mode jit_mode = jit::Jit::Mode::On;
+    if (const char* mode = std::getenv("MYTHON_JIT")) {
+        if (mode == "off"sv) {
+            jit_mode = jit::Jit::Mode::Off;
+        } else if (mode == "diff"sv) {
+            jit_mode = jit::Jit::Mode::Differential;
+        }
+    }
+    jit::Jit jit(jit_mode);
+    context.SetMethodCompiler(&jit);
+
+    // MYTHON_GC=off turns off the cycle collector, MYTHON_GC=stress collects before every new
+    // instance, MYTHON_GC=stats prints the collector statistics to stderr, MYTHON_GC=stress,stats does both
+    const char* gc_env = std::getenv("MYTHON_GC");
+    const string_view gc_mode = gc_env != nullptr ? gc_env : ""sv;
+    runtime::GarbageCollector::Config gc_config;
+    gc_config.stress = gc_mode.find("stress"sv) != string_view::npos;
+
+    optional<runtime::GarbageCollector> collector;
+    if (gc_mode != "off"sv) {
+        collector.emplace(gc_config);
+    }
+
+    // declared after the collector, instances left in the variables are collected on its destruction
     runtime::Closure closure;
-    program->Execute(closure, context);
+    call_stack.Run([&] {
+        program->Execute(closure, context);
+    });
+
+    if (collector && gc_mode.find("stats"sv) != string_view::npos) {
+        const auto& stats = collector->GetStats();
+        cerr << "gc: "sv << stats.collections << " collections ("sv << stats.full_collections << " full), "sv
+             << stats.freed << " instances freed, pauses "sv << stats.total_pause.count() / 1000 << " us total, "sv
+             << stats.max_pause.count() / 1000 << " us max"sv << endl;
+    }
+
+    if (region) {
+        region->Abandon(std::move(closure));
+        if (collector) {
+            collector->Abandon();
+        }
+    }
 }
 
-int main() {
+int main(int argc, char* argv[]) {
     try {
         // TestAll();
 
+        if (argc > 1 && argv[1] == "--emit-cpp"sv) {
+            EmitMythonProgramCpp(cout);
+            return 0;
+        }
+
         LoadRunMythonProgram(cin, cout);
     } catch (const std::exception& e) {
         std::cerr << e.what() << std::endl;
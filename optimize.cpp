@@ -0,0 +1,1399 @@
+#include "optimize.h"
+
+#include "statement.h"
+
+#include <algorithm>
+#include <deque>
+#include <map>
+#include <optional>
+#include <unordered_map>
+#include <unordered_set>
+
+using namespace std;
+
+namespace optimize {
+
+    using ast::Statement;
+
+    namespace {
+        const string SELF_OBJECT = "self"s;
+
+        // Post-order traversal, rewrite may replace the visited node
+        void Walk(unique_ptr<Statement>& node, const Statement::ChildVisitor& rewrite) {
+            if (!node) {
+                return;
+            }
+
+            node->ForEachChild([&rewrite](unique_ptr<Statement>& child) {
+                Walk(child, rewrite);
+            });
+
+            rewrite(node);
+        }
+
+        bool IsSelf(const Statement* statement) {
+            const auto* var = dynamic_cast<const ast::VariableValue*>(statement);
+            return var != nullptr && var->GetDottedIds() == vector<string>{ SELF_OBJECT };
+        }
+
+        bool IsConstant(const Statement* statement) {
+            return dynamic_cast<const ast::NumericConst*>(statement) != nullptr
+                   || dynamic_cast<const ast::StringConst*>(statement) != nullptr
+                   || dynamic_cast<const ast::BoolConst*>(statement) != nullptr
+                   || dynamic_cast<const ast::None*>(statement) != nullptr;
+        }
+
+        bool IsFieldOf(const Statement* statement, const ast::VariableValue& object, const string& field_name) {
+            const auto* var = dynamic_cast<const ast::VariableValue*>(statement);
+            if (var == nullptr) {
+                return false;
+            }
+
+            const auto& ids = var->GetDottedIds();
+            const auto& object_ids = object.GetDottedIds();
+
+            return ids.size() == object_ids.size() + 1 && ids.back() == field_name
+                   && equal(object_ids.begin(), object_ids.end(), ids.begin());
+        }
+
+        const runtime::Number* AsNumericConst(const Statement* statement) {
+            const auto* num = dynamic_cast<const ast::NumericConst*>(statement);
+            return num != nullptr ? &num->GetValue() : nullptr;
+        }
+
+        unique_ptr<Statement> FuseFieldAssignment(unique_ptr<ast::FieldAssignment> assignment) {
+            const auto& object = assignment->GetObject();
+            const auto& field_name = assignment->GetFieldName();
+            Statement* rv = assignment->GetRv();
+
+            if (const auto* add = dynamic_cast<const ast::Add*>(rv)) {
+                if (IsFieldOf(add->GetLhs(), object, field_name)) {
+                    if (const auto* num = AsNumericConst(add->GetRhs())) {
+                        return make_unique<ast::FieldIncrement>(std::move(assignment), num->GetValue());
+                    }
+                }
+                if (IsFieldOf(add->GetRhs(), object, field_name)) {
+                    if (const auto* num = AsNumericConst(add->GetLhs())) {
+                        return make_unique<ast::FieldIncrement>(std::move(assignment), num->GetValue());
+                    }
+                }
+            }
+
+            if (const auto* sub = dynamic_cast<const ast::Sub*>(rv)) {
+                if (IsFieldOf(sub->GetLhs(), object, field_name)) {
+                    // the minimum value has no negation
+                    const auto* num = AsNumericConst(sub->GetRhs());
+                    if (num != nullptr && num->GetValue() != INT64_MIN) {
+                        return make_unique<ast::FieldIncrement>(std::move(assignment), -num->GetValue());
+                    }
+                }
+            }
+
+            if (const auto* source = dynamic_cast<const ast::VariableValue*>(rv)) {
+                if (source->GetDottedIds().size() > 1) {
+                    return make_unique<ast::FieldCopy>(object, field_name, *source);
+                }
+            }
+
+            return assignment;
+        }
+
+        void FuseNode(unique_ptr<Statement>& node) {
+            if (dynamic_cast<ast::FieldAssignment*>(node.get()) != nullptr) {
+                unique_ptr<ast::FieldAssignment> assignment(static_cast<ast::FieldAssignment*>(node.release()));
+                node = FuseFieldAssignment(std::move(assignment));
+                return;
+            }
+
+            if (auto* call = dynamic_cast<ast::MethodCall*>(node.get())) {
+                if (!IsSelf(call->GetObject())) {
+                    return;
+                }
+
+                const auto& args = call->GetArgs();
+                if (!all_of(args.begin(), args.end(), [](const auto& arg) { return IsConstant(arg.get()); })) {
+                    return;
+                }
+
+                unique_ptr<ast::MethodCall> original(static_cast<ast::MethodCall*>(node.release()));
+                node = make_unique<ast::SelfMethodCall>(std::move(original));
+            }
+        }
+
+        void EliminateClassTailCalls(runtime::Class& cls);
+
+        // Rewrites tail calls of method inside the statement, nested classes are handled on their own
+        void RewriteTailCalls(unique_ptr<Statement>& node, const runtime::Method& method) {
+            if (!node) {
+                return;
+            }
+
+            if (auto* class_definition = dynamic_cast<ast::ClassDefinition*>(node.get())) {
+                EliminateClassTailCalls(class_definition->GetClass());
+                return;
+            }
+
+            node->ForEachChild([&method](unique_ptr<Statement>& child) {
+                RewriteTailCalls(child, method);
+            });
+
+            auto* ret = dynamic_cast<ast::Return*>(node.get());
+            if (ret == nullptr) {
+                return;
+            }
+
+            auto* call = dynamic_cast<ast::MethodCall*>(ret->GetStatement());
+            if (call == nullptr || !IsSelf(call->GetObject()) || call->GetMethodName() != method.name
+                || call->GetArgs().size() != method.formal_params.size()) {
+                return;
+            }
+
+            unique_ptr<ast::Return> original(static_cast<ast::Return*>(node.release()));
+            node = make_unique<ast::TailCall>(method, std::move(original));
+        }
+
+        void EliminateClassTailCalls(runtime::Class& cls) {
+            for (auto& method : cls.Methods()) {
+                // frame reuse is implemented by MethodBody
+                if (dynamic_cast<ast::MethodBody*>(method.body.get()) != nullptr) {
+                    RewriteTailCalls(method.body, method);
+                }
+            }
+        }
+
+        // Names of the callee (self and parameters) mapped to the caller expressions
+        using Substitution = unordered_map<string, const Statement*>;
+
+        unique_ptr<Statement> CloneExpression(const Statement* node, const Substitution& substitution);
+
+        template <typename Const>
+        bool TryCloneConstant(const Statement* node, unique_ptr<Statement>& result) {
+            const auto* constant = dynamic_cast<const Const*>(node);
+            if (constant == nullptr) {
+                return false;
+            }
+
+            result = make_unique<Const>(constant->GetValue());
+            return true;
+        }
+
+        template <typename Operation>
+        bool TryCloneUnary(const Statement* node, const Substitution& substitution, unique_ptr<Statement>& result) {
+            const auto* operation = dynamic_cast<const Operation*>(node);
+            if (operation == nullptr) {
+                return false;
+            }
+
+            if (auto argument = CloneExpression(operation->GetArgument(), substitution)) {
+                result = make_unique<Operation>(std::move(argument));
+            }
+            return true;
+        }
+
+        template <typename Operation>
+        bool TryCloneBinary(const Statement* node, const Substitution& substitution, unique_ptr<Statement>& result) {
+            const auto* operation = dynamic_cast<const Operation*>(node);
+            if (operation == nullptr) {
+                return false;
+            }
+
+            auto lhs = CloneExpression(operation->GetLhs(), substitution);
+            auto rhs = CloneExpression(operation->GetRhs(), substitution);
+            if (lhs && rhs) {
+                result = make_unique<Operation>(std::move(lhs), std::move(rhs));
+            }
+            return true;
+        }
+
+        unique_ptr<Statement> CloneConstant(const Statement* node) {
+            unique_ptr<Statement> result;
+
+            if (dynamic_cast<const ast::None*>(node) != nullptr) {
+                result = make_unique<ast::None>();
+            } else {
+                TryCloneConstant<ast::NumericConst>(node, result) || TryCloneConstant<ast::StringConst>(node, result)
+                    || TryCloneConstant<ast::BoolConst>(node, result);
+            }
+
+            return result;
+        }
+
+        unique_ptr<ast::VariableValue> SubstituteVariable(const ast::VariableValue& var,
+                                                          const Substitution& substitution) {
+            const auto& ids = var.GetDottedIds();
+
+            auto it = substitution.find(ids.front());
+            if (it == substitution.end()) {
+                return nullptr;
+            }
+
+            const auto* replacement = dynamic_cast<const ast::VariableValue*>(it->second);
+            if (replacement == nullptr) {
+                return nullptr;
+            }
+
+            vector<string> dotted_ids = replacement->GetDottedIds();
+            dotted_ids.insert(dotted_ids.end(), ids.begin() + 1, ids.end());
+
+            return make_unique<ast::VariableValue>(std::move(dotted_ids));
+        }
+
+        // Returns nullptr if the expression has nodes other than variables, constants and operators,
+        // or refers to names missing in the substitution
+        unique_ptr<Statement> CloneExpression(const Statement* node, const Substitution& substitution) {
+            if (node == nullptr) {
+                return nullptr;
+            }
+
+            if (const auto* var = dynamic_cast<const ast::VariableValue*>(node)) {
+                const auto& ids = var->GetDottedIds();
+                auto it = substitution.find(ids.front());
+
+                if (it != substitution.end() && ids.size() == 1 && IsConstant(it->second)) {
+                    return CloneConstant(it->second);
+                }
+                return SubstituteVariable(*var, substitution);
+            }
+
+            if (IsConstant(node)) {
+                return CloneConstant(node);
+            }
+
+            unique_ptr<Statement> result;
+
+            TryCloneUnary<ast::Stringify>(node, substitution, result)
+                || TryCloneUnary<ast::Not>(node, substitution, result)
+                || TryCloneBinary<ast::Add>(node, substitution, result)
+                || TryCloneBinary<ast::Sub>(node, substitution, result)
+                || TryCloneBinary<ast::Mult>(node, substitution, result)
+                || TryCloneBinary<ast::Div>(node, substitution, result)
+                || TryCloneBinary<ast::Or>(node, substitution, result)
+                || TryCloneBinary<ast::And>(node, substitution, result)
+                || TryCloneBinary<ast::EqualComparison>(node, substitution, result)
+                || TryCloneBinary<ast::NotEqualComparison>(node, substitution, result)
+                || TryCloneBinary<ast::LessComparison>(node, substitution, result)
+                || TryCloneBinary<ast::GreaterComparison>(node, substitution, result)
+                || TryCloneBinary<ast::LessOrEqualComparison>(node, substitution, result)
+                || TryCloneBinary<ast::GreaterOrEqualComparison>(node, substitution, result);
+
+            return result;
+        }
+
+        // Returns the only statement of the method body, or nullptr
+        const Statement* GetSingleStatement(const runtime::Method& method) {
+            const auto* method_body = dynamic_cast<const ast::MethodBody*>(method.body.get());
+            if (method_body == nullptr) {
+                return nullptr;
+            }
+
+            auto* compound = dynamic_cast<ast::Compound*>(method_body->GetBody());
+            if (compound == nullptr) {
+                return nullptr;
+            }
+
+            vector<const Statement*> statements;
+            compound->ForEachChild([&statements](unique_ptr<Statement>& statement) {
+                statements.push_back(statement.get());
+            });
+
+            return statements.size() == 1 ? statements.front() : nullptr;
+        }
+
+        // Builds the method body for the call site, returns nullptr if the method can't be inlined
+        unique_ptr<Statement> InlineBody(const runtime::Method& method, const ast::MethodCall& call,
+                                         bool& returns_value) {
+            const Statement* statement = GetSingleStatement(method);
+            if (statement == nullptr) {
+                return nullptr;
+            }
+
+            Substitution substitution;
+            substitution[SELF_OBJECT] = call.GetObject();
+            for (size_t i = 0; i < method.formal_params.size(); ++i) {
+                substitution[method.formal_params[i]] = call.GetArgs()[i].get();
+            }
+
+            if (const auto* ret = dynamic_cast<const ast::Return*>(statement)) {
+                returns_value = true;
+                return CloneExpression(ret->GetStatement(), substitution);
+            }
+
+            if (const auto* assignment = dynamic_cast<const ast::FieldAssignment*>(statement)) {
+                returns_value = false;
+
+                auto object = SubstituteVariable(assignment->GetObject(), substitution);
+                auto rv = CloneExpression(assignment->GetRv(), substitution);
+                if (!object || !rv) {
+                    return nullptr;
+                }
+
+                return make_unique<ast::FieldAssignment>(std::move(*object), assignment->GetFieldName(),
+                                                         std::move(rv));
+            }
+
+            return nullptr;
+        }
+
+        struct InlineCandidate {
+            const runtime::Class* cls = nullptr;
+            const runtime::Method* method = nullptr;
+            size_t definitions = 0;
+        };
+
+        using InlineCandidates = map<pair<string, size_t>, InlineCandidate>;
+
+        void InlineCall(unique_ptr<Statement>& node, const InlineCandidates& candidates) {
+            auto* call = dynamic_cast<ast::MethodCall*>(node.get());
+            if (call == nullptr || dynamic_cast<const ast::VariableValue*>(call->GetObject()) == nullptr) {
+                return;
+            }
+
+            const auto& args = call->GetArgs();
+            if (!all_of(args.begin(), args.end(), [](const auto& arg) {
+                    return IsConstant(arg.get()) || dynamic_cast<const ast::VariableValue*>(arg.get()) != nullptr;
+                })) {
+                return;
+            }
+
+            auto it = candidates.find({ call->GetMethodName(), args.size() });
+            if (it == candidates.end() || it->second.definitions != 1 || it->second.method == nullptr) {
+                return;
+            }
+
+            const auto& [cls, method, definitions] = it->second;
+
+            bool returns_value = false;
+            auto body = InlineBody(*method, *call, returns_value);
+            if (!body) {
+                return;
+            }
+
+            unique_ptr<ast::MethodCall> original(static_cast<ast::MethodCall*>(node.release()));
+            node = make_unique<ast::InlinedMethodCall>(std::move(original), *cls, std::move(body), returns_value);
+        }
+
+        bool IsComparison(const Statement* node) {
+            return dynamic_cast<const ast::EqualComparison*>(node) != nullptr
+                   || dynamic_cast<const ast::NotEqualComparison*>(node) != nullptr
+                   || dynamic_cast<const ast::LessComparison*>(node) != nullptr
+                   || dynamic_cast<const ast::GreaterComparison*>(node) != nullptr
+                   || dynamic_cast<const ast::LessOrEqualComparison*>(node) != nullptr
+                   || dynamic_cast<const ast::GreaterOrEqualComparison*>(node) != nullptr;
+        }
+
+        enum class Type {
+            Unknown, // nothing is assigned yet
+            Int,
+            Bool,
+            Str,
+            Dynamic,
+        };
+
+        Type Join(Type lhs, Type rhs) {
+            if (lhs == Type::Unknown) {
+                return rhs;
+            }
+            if (rhs == Type::Unknown || lhs == rhs) {
+                return lhs;
+            }
+            return Type::Dynamic;
+        }
+
+        class TypeInference {
+        public:
+            explicit TypeInference(unique_ptr<Statement>& program) {
+                AddScope(program, {});
+            }
+
+            void Run() {
+                changed_ = true;
+                while (changed_) {
+                    changed_ = false;
+                    for (auto& [root, scope] : scopes_) {
+                        CollectAssignments(*root, scope);
+                    }
+                }
+
+                for (auto& [root, scope] : scopes_) {
+                    Rewrite(*root, scope);
+                }
+            }
+
+        private:
+            using Scope = unordered_map<string, Type>;
+
+            void AddScope(unique_ptr<Statement>& root, const vector<string>& params) {
+                auto& [scope_root, scope] = scopes_.emplace_back(&root, Scope{});
+
+                scope[SELF_OBJECT] = Type::Dynamic;
+                for (const auto& param : params) {
+                    scope[param] = Type::Dynamic;
+                }
+
+                FindClasses(*scope_root, scope);
+            }
+
+            // Method bodies of classes defined in the scope are scopes on their own
+            void FindClasses(unique_ptr<Statement>& node, Scope& scope) {
+                if (!node) {
+                    return;
+                }
+
+                if (auto* class_definition = dynamic_cast<ast::ClassDefinition*>(node.get())) {
+                    auto& cls = class_definition->GetClass();
+                    scope[cls.GetName()] = Type::Dynamic;
+
+                    for (auto& method : cls.Methods()) {
+                        AddScope(method.body, method.formal_params);
+                    }
+                    return;
+                }
+
+                node->ForEachChild([this, &scope](unique_ptr<Statement>& child) {
+                    FindClasses(child, scope);
+                });
+            }
+
+            void Assign(Type& target, Type type) {
+                Type joined = Join(target, type);
+                if (joined != target) {
+                    target = joined;
+                    changed_ = true;
+                }
+            }
+
+            void CollectAssignments(unique_ptr<Statement>& node, Scope& scope) {
+                if (!node || dynamic_cast<ast::ClassDefinition*>(node.get()) != nullptr) {
+                    return;
+                }
+
+                if (const auto* assignment = dynamic_cast<const ast::Assignment*>(node.get())) {
+                    Assign(scope[assignment->var_], TypeOf(assignment->rv_.get(), scope));
+                } else if (const auto* assignment = dynamic_cast<const ast::FieldAssignment*>(node.get())) {
+                    Assign(fields_[assignment->GetFieldName()], TypeOf(assignment->GetRv(), scope));
+                } else if (const auto* increment = dynamic_cast<const ast::FieldIncrement*>(node.get())) {
+                    const auto& assignment = increment->GetOriginal();
+                    Assign(fields_[assignment.GetFieldName()], TypeOf(assignment.GetRv(), scope));
+                } else if (const auto* copy = dynamic_cast<const ast::FieldCopy*>(node.get())) {
+                    Assign(fields_[copy->GetFieldName()], TypeOf(&copy->GetSource(), scope));
+                }
+
+                node->ForEachChild([this, &scope](unique_ptr<Statement>& child) {
+                    CollectAssignments(child, scope);
+                });
+            }
+
+            Type TypeOfVariable(const ast::VariableValue& var, const Scope& scope) const {
+                const auto& ids = var.GetDottedIds();
+                const auto& types = ids.size() == 1 ? scope : fields_;
+
+                auto it = types.find(ids.back());
+                return it != types.end() ? it->second : Type::Unknown;
+            }
+
+            template <typename Operation>
+            bool IsArithmetic(const Statement* node) const {
+                return dynamic_cast<const Operation*>(node) != nullptr;
+            }
+
+            Type TypeOf(const Statement* node, const Scope& scope) const {
+                if (const auto* var = dynamic_cast<const ast::VariableValue*>(node)) {
+                    return TypeOfVariable(*var, scope);
+                }
+                if (dynamic_cast<const ast::NumericConst*>(node) != nullptr) {
+                    return Type::Int;
+                }
+                if (dynamic_cast<const ast::StringConst*>(node) != nullptr
+                    || dynamic_cast<const ast::Stringify*>(node) != nullptr) {
+                    return Type::Str;
+                }
+                if (dynamic_cast<const ast::BoolConst*>(node) != nullptr
+                    || dynamic_cast<const ast::Or*>(node) != nullptr
+                    || dynamic_cast<const ast::And*>(node) != nullptr
+                    || dynamic_cast<const ast::Not*>(node) != nullptr || IsComparison(node)) {
+                    return Type::Bool;
+                }
+
+                const auto* operation = dynamic_cast<const ast::BinaryOperation*>(node);
+                if (operation == nullptr) {
+                    return Type::Dynamic;
+                }
+
+                Type lhs = TypeOf(operation->GetLhs(), scope);
+                Type rhs = TypeOf(operation->GetRhs(), scope);
+                if (lhs == Type::Unknown || rhs == Type::Unknown) {
+                    return Type::Unknown;
+                }
+
+                if (dynamic_cast<const ast::Add*>(node) != nullptr) {
+                    if (lhs == Type::Int && rhs == Type::Int) {
+                        return Type::Int;
+                    }
+                    return lhs == Type::Str && rhs == Type::Str ? Type::Str : Type::Dynamic;
+                }
+
+                if (dynamic_cast<const ast::Sub*>(node) != nullptr || dynamic_cast<const ast::Mult*>(node) != nullptr
+                    || dynamic_cast<const ast::Div*>(node) != nullptr) {
+                    return lhs == Type::Int && rhs == Type::Int ? Type::Int : Type::Dynamic;
+                }
+
+                return Type::Dynamic;
+            }
+
+            // Builds the typed tree of an expression of type int
+            unique_ptr<ast::IntExpression> BuildInt(const Statement* node) const {
+                if (const auto* num = AsNumericConst(node)) {
+                    return make_unique<ast::IntConst>(num->GetValue());
+                }
+                if (const auto* var = dynamic_cast<const ast::VariableValue*>(node)) {
+                    return make_unique<ast::IntVariable>(*var);
+                }
+
+                const auto* operation = static_cast<const ast::BinaryOperation*>(node);
+                auto lhs = BuildInt(operation->GetLhs());
+                auto rhs = BuildInt(operation->GetRhs());
+
+                if (dynamic_cast<const ast::Add*>(node) != nullptr) {
+                    return make_unique<ast::IntOperation<ast::arithmetic::Add>>(std::move(lhs), std::move(rhs));
+                }
+                if (dynamic_cast<const ast::Sub*>(node) != nullptr) {
+                    return make_unique<ast::IntOperation<ast::arithmetic::Sub>>(std::move(lhs), std::move(rhs));
+                }
+                if (dynamic_cast<const ast::Mult*>(node) != nullptr) {
+                    return make_unique<ast::IntOperation<ast::arithmetic::Mult>>(std::move(lhs), std::move(rhs));
+                }
+                return make_unique<ast::IntOperation<ast::arithmetic::Div>>(std::move(lhs), std::move(rhs));
+            }
+
+            template <typename Cmp>
+            bool TryRewriteComparison(unique_ptr<Statement>& node, const Scope& scope) const {
+                const auto* comparison = dynamic_cast<const ast::Comparison<Cmp>*>(node.get());
+                if (comparison == nullptr) {
+                    return false;
+                }
+
+                if (TypeOf(comparison->GetLhs(), scope) != Type::Int || TypeOf(comparison->GetRhs(), scope) != Type::Int) {
+                    return false;
+                }
+
+                auto lhs = BuildInt(comparison->GetLhs());
+                auto rhs = BuildInt(comparison->GetRhs());
+                node = make_unique<ast::UnboxedComparison<Cmp>>(std::move(lhs), std::move(rhs), std::move(node));
+                return true;
+            }
+
+            // Flattens a chain of string additions, returns false if a part is not a plain read
+            bool CollectStringParts(const Statement* node, const Scope& scope, vector<ast::StringConcat::Part>& parts) const {
+                if (const auto* add = dynamic_cast<const ast::Add*>(node)) {
+                    return CollectStringParts(add->GetLhs(), scope, parts)
+                           && CollectStringParts(add->GetRhs(), scope, parts);
+                }
+
+                if (const auto* str = dynamic_cast<const ast::StringConst*>(node)) {
+                    parts.push_back({ make_unique<ast::StringConst>(str->GetValue()), false });
+                    return true;
+                }
+
+                if (const auto* var = dynamic_cast<const ast::VariableValue*>(node)) {
+                    parts.push_back({ make_unique<ast::VariableValue>(*var), false });
+                    return true;
+                }
+
+                if (const auto* stringify = dynamic_cast<const ast::Stringify*>(node)) {
+                    const auto* var = dynamic_cast<const ast::VariableValue*>(stringify->GetArgument());
+                    Type type = var != nullptr ? TypeOfVariable(*var, scope) : Type::Dynamic;
+
+                    if (type == Type::Int || type == Type::Str || type == Type::Bool) {
+                        parts.push_back({ make_unique<ast::VariableValue>(*var), true });
+                        return true;
+                    }
+                }
+
+                return false;
+            }
+
+            void Rewrite(unique_ptr<Statement>& node, const Scope& scope) const {
+                if (!node || dynamic_cast<ast::ClassDefinition*>(node.get()) != nullptr) {
+                    return;
+                }
+
+                bool arithmetic = IsArithmetic<ast::Add>(node.get()) || IsArithmetic<ast::Sub>(node.get())
+                                  || IsArithmetic<ast::Mult>(node.get()) || IsArithmetic<ast::Div>(node.get());
+
+                if (arithmetic) {
+                    Type type = TypeOf(node.get(), scope);
+
+                    if (type == Type::Int) {
+                        auto expression = BuildInt(node.get());
+                        node = make_unique<ast::UnboxedInt>(std::move(expression), std::move(node));
+                        return;
+                    }
+
+                    vector<ast::StringConcat::Part> parts;
+                    if (type == Type::Str && CollectStringParts(node.get(), scope, parts)) {
+                        node = make_unique<ast::StringConcat>(std::move(parts), std::move(node));
+                        return;
+                    }
+                }
+
+                if (TryRewriteComparison<ast::compare::Equal>(node, scope)
+                    || TryRewriteComparison<ast::compare::NotEqual>(node, scope)
+                    || TryRewriteComparison<ast::compare::Less>(node, scope)
+                    || TryRewriteComparison<ast::compare::Greater>(node, scope)
+                    || TryRewriteComparison<ast::compare::LessOrEqual>(node, scope)
+                    || TryRewriteComparison<ast::compare::GreaterOrEqual>(node, scope)) {
+                    return;
+                }
+
+                node->ForEachChild([this, &scope](unique_ptr<Statement>& child) {
+                    Rewrite(child, scope);
+                });
+            }
+
+            // deque keeps scopes in place while nested classes are added
+            deque<pair<unique_ptr<Statement>*, Scope>> scopes_;
+            unordered_map<string, Type> fields_;
+            bool changed_ = false;
+        };
+
+        bool IsDunder(const string& name) {
+            return name.size() > 4 && name.compare(0, 2, "__"s) == 0 && name.compare(name.size() - 2, 2, "__"s) == 0;
+        }
+
+        // Root compound of the program or of a method body
+        ast::Compound* GetScopeCompound(Statement* root) {
+            if (auto* method_body = dynamic_cast<ast::MethodBody*>(root)) {
+                root = method_body->GetBody();
+            }
+            return dynamic_cast<ast::Compound*>(root);
+        }
+
+        // Calls function for every statement of the scope, nested classes are not entered
+        template <typename Function>
+        void VisitScope(unique_ptr<Statement>& node, Function& function) {
+            if (!node) {
+                return;
+            }
+
+            function(node);
+
+            if (dynamic_cast<ast::ClassDefinition*>(node.get()) == nullptr) {
+                node->ForEachChild([&function](unique_ptr<Statement>& child) {
+                    VisitScope(child, function);
+                });
+            }
+        }
+
+        // Variables assigned once, by a constant, at the top level of the scope are replaced
+        // by the constant in the statements that follow the assignment
+        void PropagateConstants(Statement* root, const vector<string>& params) {
+            auto* compound = GetScopeCompound(root);
+            if (compound == nullptr) {
+                return;
+            }
+
+            unordered_map<string, size_t> assignments;
+            for (const auto& param : params) {
+                ++assignments[param];
+            }
+            ++assignments[SELF_OBJECT];
+
+            auto count = [&assignments](unique_ptr<Statement>& node) {
+                if (const auto* assignment = dynamic_cast<const ast::Assignment*>(node.get())) {
+                    ++assignments[assignment->var_];
+                } else if (const auto* class_definition = dynamic_cast<const ast::ClassDefinition*>(node.get())) {
+                    ++assignments[class_definition->GetClass().GetName()];
+                }
+            };
+            for (auto& statement : compound->Statements()) {
+                VisitScope(statement, count);
+            }
+
+            auto& statements = compound->Statements();
+            for (size_t i = 0; i < statements.size(); ++i) {
+                const auto* assignment = dynamic_cast<const ast::Assignment*>(statements[i].get());
+                if (assignment == nullptr || assignments[assignment->var_] != 1 || !IsConstant(assignment->rv_.get())) {
+                    continue;
+                }
+
+                const Statement* value = assignment->rv_.get();
+                const vector<string> var{ assignment->var_ };
+
+                auto substitute = [value, &var](unique_ptr<Statement>& node) {
+                    const auto* read = dynamic_cast<const ast::VariableValue*>(node.get());
+                    if (read != nullptr && read->GetDottedIds() == var) {
+                        node = CloneConstant(value);
+                    }
+                };
+                for (size_t j = i + 1; j < statements.size(); ++j) {
+                    VisitScope(statements[j], substitute);
+                }
+            }
+        }
+
+        bool IsFoldable(const Statement* node) {
+            return dynamic_cast<const ast::Add*>(node) != nullptr || dynamic_cast<const ast::Sub*>(node) != nullptr
+                   || dynamic_cast<const ast::Mult*>(node) != nullptr || dynamic_cast<const ast::Div*>(node) != nullptr
+                   || dynamic_cast<const ast::Or*>(node) != nullptr || dynamic_cast<const ast::And*>(node) != nullptr
+                   || dynamic_cast<const ast::Not*>(node) != nullptr
+                   || dynamic_cast<const ast::Stringify*>(node) != nullptr || IsComparison(node);
+        }
+
+        // Operators over constants never call user code, so they are evaluated right away.
+        // Operations failing at run time (division by zero, wrong operands) are kept
+        void FoldConstants(unique_ptr<Statement>& node) {
+            if (!IsFoldable(node.get())) {
+                return;
+            }
+
+            bool constant_operands = true;
+            node->ForEachChild([&constant_operands](unique_ptr<Statement>& child) {
+                constant_operands = constant_operands && IsConstant(child.get());
+            });
+            if (!constant_operands) {
+                return;
+            }
+
+            runtime::Closure closure;
+            runtime::DummyContext context;
+            runtime::ObjectHolder value;
+
+            try {
+                value = node->Execute(closure, context);
+            } catch (const std::runtime_error&) {
+                return;
+            }
+
+            if (const auto* num = value.TryAs<runtime::Number>()) {
+                node = make_unique<ast::NumericConst>(*num);
+            } else if (const auto* str = value.TryAs<runtime::String>()) {
+                node = make_unique<ast::StringConst>(*str);
+            } else if (const auto* boolean = value.TryAs<runtime::Bool>()) {
+                node = make_unique<ast::BoolConst>(*boolean);
+            }
+        }
+
+        bool IsConstantCondition(Statement* condition, bool& value) {
+            if (!IsConstant(condition)) {
+                return false;
+            }
+
+            runtime::Closure closure;
+            runtime::DummyContext context;
+            value = condition->ExecuteCondition(closure, context);
+
+            return true;
+        }
+
+        bool IsJump(const Statement* statement) {
+            return dynamic_cast<const ast::Return*>(statement) != nullptr
+                   || dynamic_cast<const ast::Break*>(statement) != nullptr
+                   || dynamic_cast<const ast::Continue*>(statement) != nullptr;
+        }
+
+        void PruneNode(unique_ptr<Statement>& node) {
+            FoldConstants(node);
+
+            bool value = false;
+
+            if (auto* if_else = dynamic_cast<ast::IfElse*>(node.get())) {
+                if (IsConstantCondition(if_else->GetCondition(), value)) {
+                    auto branch = if_else->ReleaseBranch(value);
+                    node = branch ? std::move(branch) : make_unique<ast::Compound>();
+                }
+                return;
+            }
+
+            if (auto* loop = dynamic_cast<ast::While*>(node.get())) {
+                if (IsConstantCondition(loop->GetCondition(), value) && !value) {
+                    node = make_unique<ast::Compound>();
+                }
+                return;
+            }
+
+            auto* compound = dynamic_cast<ast::Compound*>(node.get());
+            if (compound == nullptr) {
+                return;
+            }
+
+            // Nested compounds are flattened, statements after return, break or continue are dropped
+            vector<unique_ptr<Statement>> statements;
+            for (auto& statement : compound->Statements()) {
+                if (auto* nested = dynamic_cast<ast::Compound*>(statement.get())) {
+                    for (auto& nested_statement : nested->Statements()) {
+                        statements.push_back(std::move(nested_statement));
+                    }
+                } else {
+                    statements.push_back(std::move(statement));
+                }
+            }
+
+            auto jump = find_if(statements.begin(), statements.end(), [](const auto& statement) {
+                return IsJump(statement.get());
+            });
+            if (jump != statements.end()) {
+                statements.erase(next(jump), statements.end());
+            }
+
+            compound->Statements() = std::move(statements);
+        }
+
+        // Classes are reachable if the program creates their instances or refers to them by name,
+        // methods are reachable if they are special (__init__, __str__, ...) or called somewhere in
+        // the reachable code
+        class Reachability {
+        public:
+            explicit Reachability(unique_ptr<Statement>& program) {
+                auto collect = [this](unique_ptr<Statement>& node) {
+                    if (auto* class_definition = dynamic_cast<ast::ClassDefinition*>(node.get())) {
+                        auto& cls = class_definition->GetClass();
+                        classes_by_name_[cls.GetName()].push_back(&cls);
+                    }
+                };
+                Walk(program, collect);
+
+                Scan(program);
+
+                bool changed = true;
+                while (changed) {
+                    changed = false;
+
+                    // reachable_classes_ may grow while bodies are scanned
+                    for (size_t i = 0; i < reachable_classes_.size(); ++i) {
+                        for (auto& method : reachable_classes_[i]->Methods()) {
+                            if (!reachable_methods_.count(&method)
+                                && (IsDunder(method.name) || called_methods_.count(method.name))) {
+                                reachable_methods_.insert(&method);
+                                Scan(method.body);
+                                changed = true;
+                            }
+                        }
+                    }
+                }
+            }
+
+            void RemoveUnreachable(unique_ptr<Statement>& program) {
+                Walk(program, [this](unique_ptr<Statement>& node) {
+                    auto* compound = dynamic_cast<ast::Compound*>(node.get());
+                    if (compound == nullptr) {
+                        return;
+                    }
+
+                    auto& statements = compound->Statements();
+                    statements.erase(remove_if(statements.begin(), statements.end(),
+                                               [this](const auto& statement) {
+                                                   const auto* class_definition
+                                                       = dynamic_cast<const ast::ClassDefinition*>(statement.get());
+                                                   return class_definition != nullptr
+                                                          && !IsReachable(class_definition->GetClass());
+                                               }),
+                                     statements.end());
+                });
+
+                for (auto* cls : reachable_classes_) {
+                    for (auto& method : cls->Methods()) {
+                        if (!reachable_methods_.count(&method)) {
+                            method.body.reset();
+                        }
+                    }
+                }
+            }
+
+        private:
+            bool IsReachable(const runtime::Class& cls) const {
+                return find(reachable_classes_.begin(), reachable_classes_.end(), &cls) != reachable_classes_.end();
+            }
+
+            void MarkClass(const runtime::Class* cls) {
+                for (; cls != nullptr && !IsReachable(*cls); cls = cls->GetParent()) {
+                    reachable_classes_.push_back(const_cast<runtime::Class*>(cls));
+                }
+            }
+
+            void Scan(unique_ptr<Statement>& root) {
+                auto scan = [this](unique_ptr<Statement>& node) {
+                    if (const auto* instance = dynamic_cast<const ast::NewInstance*>(node.get())) {
+                        MarkClass(&instance->GetClass());
+                    } else if (const auto* call = dynamic_cast<const ast::MethodCall*>(node.get())) {
+                        called_methods_.insert(call->GetMethodName());
+                    } else if (const auto* var = dynamic_cast<const ast::VariableValue*>(node.get())) {
+                        auto it = classes_by_name_.find(var->GetDottedIds().front());
+                        if (it != classes_by_name_.end()) {
+                            for (const auto* cls : it->second) {
+                                MarkClass(cls);
+                            }
+                        }
+                    }
+                };
+                VisitScope(root, scan);
+            }
+
+            unordered_map<string, vector<const runtime::Class*>> classes_by_name_;
+            vector<runtime::Class*> reachable_classes_;
+            unordered_set<const runtime::Method*> reachable_methods_;
+            unordered_set<string> called_methods_;
+        };
+
+        class CommonPathElimination {
+        public:
+            void Region(unique_ptr<Statement>& node) {
+                Flush();
+                Visit(node);
+                Flush();
+            }
+
+        private:
+            struct Occurrence {
+                ast::VariableValue* var;
+                size_t root_generation;
+            };
+
+            // Nodes evaluating children in order with no side effects of their own
+            static bool IsTransparent(const Statement* node) {
+                return dynamic_cast<const ast::Sub*>(node) != nullptr || dynamic_cast<const ast::Mult*>(node) != nullptr
+                       || dynamic_cast<const ast::Div*>(node) != nullptr || dynamic_cast<const ast::Or*>(node) != nullptr
+                       || dynamic_cast<const ast::And*>(node) != nullptr || dynamic_cast<const ast::Not*>(node) != nullptr
+                       || dynamic_cast<const ast::Compound*>(node) != nullptr;
+            }
+
+            // Nodes evaluating children in order, then possibly running user code or storing fields
+            static bool IsBarrierAfterChildren(const Statement* node) {
+                return dynamic_cast<const ast::Add*>(node) != nullptr || IsComparison(node)
+                       || dynamic_cast<const ast::Stringify*>(node) != nullptr
+                       || dynamic_cast<const ast::MethodCall*>(node) != nullptr
+                       || dynamic_cast<const ast::NewInstance*>(node) != nullptr
+                       || dynamic_cast<const ast::FieldAssignment*>(node) != nullptr
+                       || dynamic_cast<const ast::Return*>(node) != nullptr;
+            }
+
+            void VisitChildren(unique_ptr<Statement>& node) {
+                node->ForEachChild([this](unique_ptr<Statement>& child) {
+                    Visit(child);
+                });
+            }
+
+            // Follows the evaluation order of the nodes
+            void Visit(unique_ptr<Statement>& node) {
+                if (!node || IsConstant(node.get())) {
+                    return;
+                }
+
+                if (auto* var = dynamic_cast<ast::VariableValue*>(node.get())) {
+                    window_.push_back({ var, root_generations_[var->GetDottedIds().front()] });
+                } else if (IsTransparent(node.get())) {
+                    VisitChildren(node);
+                } else if (IsBarrierAfterChildren(node.get())) {
+                    VisitChildren(node);
+                    Flush();
+                } else if (auto* assignment = dynamic_cast<ast::Assignment*>(node.get())) {
+                    Visit(assignment->rv_);
+                    ++root_generations_[assignment->var_];
+                } else if (dynamic_cast<ast::Print*>(node.get()) != nullptr) {
+                    // every argument is printed right after evaluation
+                    node->ForEachChild([this](unique_ptr<Statement>& child) {
+                        Visit(child);
+                        Flush();
+                    });
+                } else if (dynamic_cast<ast::IfElse*>(node.get()) != nullptr) {
+                    bool condition = true;
+                    node->ForEachChild([this, &condition](unique_ptr<Statement>& child) {
+                        if (condition) {
+                            Visit(child);
+                            condition = false;
+                        } else {
+                            Region(child);
+                        }
+                    });
+                } else if (dynamic_cast<ast::While*>(node.get()) != nullptr) {
+                    // the condition and the body run one after another on every iteration
+                    Flush();
+                    VisitChildren(node);
+                    Flush();
+                } else if (auto* class_definition = dynamic_cast<ast::ClassDefinition*>(node.get())) {
+                    Flush();
+                    for (auto& method : class_definition->GetClass().Methods()) {
+                        Region(method.body);
+                    }
+                } else {
+                    // method bodies, jumps and nodes made by other passes: children are separate regions
+                    Flush();
+                    node->ForEachChild([this](unique_ptr<Statement>& child) {
+                        Region(child);
+                    });
+                }
+            }
+
+            static bool HasPrefix(const Occurrence& occurrence, const Occurrence& other, size_t length) {
+                const auto& ids = occurrence.var->GetDottedIds();
+                const auto& other_ids = other.var->GetDottedIds();
+
+                return other.root_generation == occurrence.root_generation && other_ids.size() >= length
+                       && equal(ids.begin(), ids.begin() + length, other_ids.begin());
+            }
+
+            // The lookup of a prefix in the window is served by the first occurrence having it,
+            // that occurrence always walks through the prefix itself
+            void Flush() {
+                struct Use {
+                    ast::VariableValue* var;
+                    size_t length;
+                    ast::VariableValue::PathSlot slot;
+                };
+                vector<Use> uses;
+
+                for (size_t i = 1; i < window_.size(); ++i) {
+                    const auto& ids = window_[i].var->GetDottedIds();
+
+                    for (size_t length = ids.size(); length >= 2; --length) {
+                        auto first = find_if(window_.begin(), window_.begin() + i, [&](const Occurrence& other) {
+                            return HasPrefix(window_[i], other, length);
+                        });
+                        if (first == window_.begin() + i) {
+                            continue;
+                        }
+
+                        auto slot = SlotOf(*first, length);
+                        first->var->AddPathSlot(length, slot);
+                        uses.push_back({ window_[i].var, length, std::move(slot) });
+                        break;
+                    }
+                }
+
+                // the window runs in order, the last lookup using a slot empties it
+                unordered_set<const runtime::ObjectHolder*> used_later;
+                for (auto use = uses.rbegin(); use != uses.rend(); ++use) {
+                    const bool last_use = used_later.insert(use->slot.get()).second;
+                    use->var->UsePathSlot(use->length, use->slot, last_use);
+                }
+
+                window_.clear();
+                slots_.clear();
+                root_generations_.clear();
+            }
+
+            // One slot per prefix of the defining occurrence
+            ast::VariableValue::PathSlot SlotOf(const Occurrence& occurrence, size_t length) {
+                auto& slot = slots_[{ occurrence.var, length }];
+                if (!slot) {
+                    slot = make_shared<runtime::ObjectHolder>();
+                }
+                return slot;
+            }
+
+            vector<Occurrence> window_;
+            map<pair<const ast::VariableValue*, size_t>, ast::VariableValue::PathSlot> slots_;
+            unordered_map<string, size_t> root_generations_;
+        };
+
+        // Nodes whose result is never a class instance
+        bool IsPrimitive(const Statement* node) {
+            return IsConstant(node) || dynamic_cast<const ast::Sub*>(node) != nullptr
+                   || dynamic_cast<const ast::Mult*>(node) != nullptr || dynamic_cast<const ast::Div*>(node) != nullptr
+                   || dynamic_cast<const ast::Or*>(node) != nullptr || dynamic_cast<const ast::And*>(node) != nullptr
+                   || dynamic_cast<const ast::Not*>(node) != nullptr
+                   || dynamic_cast<const ast::Stringify*>(node) != nullptr || IsComparison(node)
+                   || dynamic_cast<const ast::UnboxedInt*>(node) != nullptr;
+        }
+
+        // Statements that can't run user code, so no node is reentered while they are evaluated
+        bool IsCallFree(Statement* node) {
+            if (!node) {
+                return true;
+            }
+
+            bool call_free = IsConstant(node) || dynamic_cast<const ast::VariableValue*>(node) != nullptr
+                             || dynamic_cast<const ast::Sub*>(node) != nullptr
+                             || dynamic_cast<const ast::Mult*>(node) != nullptr
+                             || dynamic_cast<const ast::Div*>(node) != nullptr
+                             || dynamic_cast<const ast::Or*>(node) != nullptr
+                             || dynamic_cast<const ast::And*>(node) != nullptr
+                             || dynamic_cast<const ast::Not*>(node) != nullptr
+                             || dynamic_cast<const ast::UnboxedInt*>(node) != nullptr
+                             || dynamic_cast<const ast::UnboxedComparison<ast::compare::Equal>*>(node) != nullptr
+                             || dynamic_cast<const ast::UnboxedComparison<ast::compare::NotEqual>*>(node) != nullptr
+                             || dynamic_cast<const ast::UnboxedComparison<ast::compare::Less>*>(node) != nullptr
+                             || dynamic_cast<const ast::UnboxedComparison<ast::compare::Greater>*>(node) != nullptr
+                             || dynamic_cast<const ast::UnboxedComparison<ast::compare::LessOrEqual>*>(node) != nullptr
+                             || dynamic_cast<const ast::UnboxedComparison<ast::compare::GreaterOrEqual>*>(node) != nullptr;
+
+            node->ForEachChild([&call_free](unique_ptr<Statement>& child) {
+                call_free = call_free && IsCallFree(child.get());
+            });
+
+            return call_free;
+        }
+
+        void MarkTemporary(Statement* node) {
+            if (auto* result = dynamic_cast<ast::ReusableResult*>(node)) {
+                result->EnableResultReuse();
+            }
+        }
+
+        // Values that may be class instances when the node is a leaf of a streamed print argument
+        bool MayBeInstance(const Statement* node) {
+            if (const auto* add = dynamic_cast<const ast::Add*>(node)) {
+                // strings are joined, numbers added, only __add__ of an instance may return one
+                return MayBeInstance(add->GetLhs());
+            }
+            return !IsPrimitive(node);
+        }
+
+        // Value held by a print argument until the whole argument is evaluated
+        struct HeldPiece {
+            Statement* node = nullptr;
+            // user code may run before the value is produced, once the pieces from this index on are consumed
+            optional<size_t> runs_code_after;
+        };
+
+        void CollectHeldPieces(Statement* node, vector<HeldPiece>& pieces) {
+            if (auto* add = dynamic_cast<ast::Add*>(node)) {
+                const size_t begin = pieces.size();
+                CollectHeldPieces(add->GetLhs(), pieces);
+                CollectHeldPieces(add->GetRhs(), pieces);
+                // the sum is produced only if the operands are not strings, from the operand pieces
+                pieces.push_back({ add, MayBeInstance(add->GetLhs()) ? optional(begin) : nullopt });
+            } else if (auto* stringify = dynamic_cast<ast::Stringify*>(node)) {
+                Statement* argument = stringify->GetArgument();
+                bool runs_code = !IsCallFree(argument) || !IsPrimitive(argument);
+                pieces.push_back({ argument, runs_code ? optional(pieces.size()) : nullopt });
+            } else {
+                pieces.push_back({ node, IsCallFree(node) ? nullopt : optional(pieces.size()) });
+            }
+        }
+
+        // Print keeps every piece of a string addition until the last one is evaluated (see ast::Print),
+        // so a piece can't be reused if user code runs after it
+        void KeepStreamedPieces(Statement* argument) {
+            vector<HeldPiece> pieces;
+            CollectHeldPieces(argument, pieces);
+
+            size_t kept = 0;
+            for (const auto& piece : pieces) {
+                kept = max(kept, piece.runs_code_after.value_or(0));
+            }
+
+            for (size_t i = 0; i < kept; ++i) {
+                if (auto* result = dynamic_cast<ast::ReusableResult*>(pieces[i].node)) {
+                    result->DisableResultReuse();
+                }
+            }
+        }
+
+        // Marks children whose results don't escape the node
+        void FindTemporaries(unique_ptr<Statement>& node) {
+            if (auto* operation = dynamic_cast<ast::BinaryOperation*>(node.get())) {
+                // the lhs result waits while the rhs is evaluated
+                if (IsCallFree(operation->GetRhs())) {
+                    MarkTemporary(operation->GetLhs());
+                }
+
+                // + and comparisons pass the rhs to a special method of an instance lhs
+                bool rhs_escapes = dynamic_cast<ast::Add*>(node.get()) != nullptr || IsComparison(node.get());
+                if (!rhs_escapes || IsPrimitive(operation->GetLhs())) {
+                    MarkTemporary(operation->GetRhs());
+                }
+            } else if (dynamic_cast<ast::UnaryOperation*>(node.get()) != nullptr) {
+                // not uses the argument as a condition, str() formats it at once
+                node->ForEachChild([](unique_ptr<Statement>& child) {
+                    MarkTemporary(child.get());
+                });
+            } else if (dynamic_cast<ast::Print*>(node.get()) != nullptr) {
+                // children are visited first, their marks are withdrawn where pieces are kept
+                node->ForEachChild([](unique_ptr<Statement>& child) {
+                    MarkTemporary(child.get());
+                    KeepStreamedPieces(child.get());
+                });
+            } else if (auto* if_else = dynamic_cast<ast::IfElse*>(node.get())) {
+                MarkTemporary(if_else->GetCondition());
+            } else if (auto* loop = dynamic_cast<ast::While*>(node.get())) {
+                MarkTemporary(loop->GetCondition());
+            }
+        }
+
+        // Methods whose result depends only on the class of self and the argument values. Method calls
+        // are resolved by name and arguments count, the way ast::MethodCall does at run time
+        class PurityAnalysis {
+        public:
+            explicit PurityAnalysis(unique_ptr<Statement>& program) {
+                Walk(program, [this](unique_ptr<Statement>& node) {
+                    if (auto* class_definition = dynamic_cast<ast::ClassDefinition*>(node.get())) {
+                        for (auto& method : class_definition->GetClass().Methods()) {
+                            methods_.push_back(&method);
+                        }
+                    }
+                });
+            }
+
+            void Run() {
+                // special methods are called implicitly, by print, str() or operators
+                for (auto* method : methods_) {
+                    if (method->body && !IsDunder(method->name)) {
+                        pure_.insert(method);
+                    }
+                }
+
+                // every candidate is assumed pure at first, so mutual recursion doesn't rule itself out
+                bool changed = true;
+                while (changed) {
+                    changed = false;
+
+                    for (auto it = pure_.begin(); it != pure_.end();) {
+                        if (IsPure((*it)->body.get())) {
+                            ++it;
+                        } else {
+                            it = pure_.erase(it);
+                            changed = true;
+                        }
+                    }
+                }
+
+                for (auto* method : methods_) {
+                    method->pure = pure_.count(method) > 0;
+                }
+            }
+
+        private:
+            // Every method the call may resolve to is pure
+            bool IsPureCall(const string& name, size_t args_count) const {
+                bool found = false;
+
+                for (const auto* method : methods_) {
+                    if (method->name == name && method->formal_params.size() == args_count) {
+                        if (pure_.count(method) == 0) {
+                            return false;
+                        }
+                        found = true;
+                    }
+                }
+
+                return found;
+            }
+
+            bool IsPure(Statement* node) const {
+                if (!node) {
+                    return true;
+                }
+
+                if (const auto* var = dynamic_cast<const ast::VariableValue*>(node)) {
+                    // fields may change between calls, self itself is not a value
+                    return var->GetDottedIds().size() == 1 && !IsSelf(var);
+                }
+
+                if (const auto* call = dynamic_cast<const ast::MethodCall*>(node)) {
+                    // arguments are values, so only self has methods to call
+                    if (!IsSelf(call->GetObject()) || !IsPureCall(call->GetMethodName(), call->GetArgs().size())) {
+                        return false;
+                    }
+
+                    return all_of(call->GetArgs().begin(), call->GetArgs().end(), [this](const auto& arg) {
+                        return IsPure(arg.get());
+                    });
+                }
+
+                // no print, field stores or new instances. Operators never get an instance, since none
+                // is reachable from the locals, so they don't run special methods
+                bool allowed = IsConstant(node) || dynamic_cast<const ast::Assignment*>(node) != nullptr
+                               || dynamic_cast<const ast::UnaryOperation*>(node) != nullptr
+                               || dynamic_cast<const ast::BinaryOperation*>(node) != nullptr
+                               || dynamic_cast<const ast::Compound*>(node) != nullptr
+                               || dynamic_cast<const ast::Return*>(node) != nullptr
+                               || dynamic_cast<const ast::IfElse*>(node) != nullptr
+                               || dynamic_cast<const ast::While*>(node) != nullptr
+                               || dynamic_cast<const ast::Break*>(node) != nullptr
+                               || dynamic_cast<const ast::Continue*>(node) != nullptr
+                               || dynamic_cast<const ast::MethodBody*>(node) != nullptr;
+
+                node->ForEachChild([this, &allowed](unique_ptr<Statement>& child) {
+                    allowed = allowed && IsPure(child.get());
+                });
+
+                return allowed;
+            }
+
+            vector<runtime::Method*> methods_;
+            unordered_set<const runtime::Method*> pure_;
+        };
+    } // namespace
+
+    void EliminateDeadCode(unique_ptr<Statement>& program) {
+        PropagateConstants(program.get(), {});
+        Walk(program, [](unique_ptr<Statement>& node) {
+            if (auto* class_definition = dynamic_cast<ast::ClassDefinition*>(node.get())) {
+                for (auto& method : class_definition->GetClass().Methods()) {
+                    PropagateConstants(method.body.get(), method.formal_params);
+                }
+            }
+        });
+
+        Walk(program, PruneNode);
+
+        Reachability reachability(program);
+        reachability.RemoveUnreachable(program);
+    }
+
+    void EliminateCommonPaths(unique_ptr<Statement>& program) {
+        CommonPathElimination().Region(program);
+    }
+
+    void InferTypes(unique_ptr<Statement>& program) {
+        TypeInference(program).Run();
+    }
+
+    void MarkPureMethods(unique_ptr<Statement>& program) {
+        PurityAnalysis(program).Run();
+    }
+
+    void ReuseTemporaries(unique_ptr<Statement>& program) {
+        Walk(program, FindTemporaries);
+    }
+
+    void InlineMethods(unique_ptr<Statement>& program) {
+        InlineCandidates candidates;
+
+        Walk(program, [&candidates](unique_ptr<Statement>& node) {
+            auto* class_definition = dynamic_cast<ast::ClassDefinition*>(node.get());
+            if (class_definition == nullptr) {
+                return;
+            }
+
+            const auto& cls = class_definition->GetClass();
+            for (const auto& method : cls.Methods()) {
+                auto& candidate = candidates[{ method.name, method.formal_params.size() }];
+                ++candidate.definitions;
+
+                if (cls.GetMethod(method.name) == &method) {
+                    candidate.cls = &cls;
+                    candidate.method = &method;
+                }
+            }
+        });
+
+        Walk(program, [&candidates](unique_ptr<Statement>& node) {
+            InlineCall(node, candidates);
+        });
+    }
+
+    void EliminateTailCalls(unique_ptr<Statement>& program) {
+        Walk(program, [](unique_ptr<Statement>& node) {
+            if (auto* class_definition = dynamic_cast<ast::ClassDefinition*>(node.get())) {
+                EliminateClassTailCalls(class_definition->GetClass());
+            }
+        });
+    }
+
+    void FuseSuperinstructions(unique_ptr<Statement>& program) {
+        Walk(program, FuseNode);
+    }
+
+    void OptimizeProgram(unique_ptr<Statement>& program) {
+        EliminateDeadCode(program);
+        MarkPureMethods(program);
+        InlineMethods(program);
+        EliminateTailCalls(program);
+        FuseSuperinstructions(program);
+        EliminateCommonPaths(program);
+        InferTypes(program);
+        ReuseTemporaries(program);
+    }
+
+} // namespace optimize
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <memory>
+
+namespace runtime {
+    class Executable;
+}
+
+namespace optimize {
+
+    // Replaces common statement patterns with fused nodes (superinstructions):
+    //  - obj.field = obj.field + const, obj.field = obj.field - const -> ast::FieldIncrement
+    //  - obj.field = other.field -> ast::FieldCopy
+    //  - self.method(consts...) -> ast::SelfMethodCall
+    void FuseSuperinstructions(std::unique_ptr<runtime::Executable>& program);
+
+    // Replaces return self.method(args) inside the same method with ast::TailCall,
+    // so self-recursion in tail position runs in constant native stack
+    void EliminateTailCalls(std::unique_ptr<runtime::Executable>& program);
+
+    // Folds operators over constants (variables assigned a constant once at the top of a scope are
+    // constants too), drops branches with constant conditions and statements after return, break
+    // and continue. Classes the program never refers to are removed, as well as bodies of methods
+    // that are never called (special methods like __str__ are always kept)
+    void EliminateDeadCode(std::unique_ptr<runtime::Executable>& program);
+
+    // Substitutes bodies of small methods (return of an expression or assignment to a field of self,
+    // without calls inside) into call sites whose receiver is a variable and arguments are variables
+    // or constants. The method must be the only one with such name and arguments count in the
+    // program, the site is guarded by the receiver class, see ast::InlinedMethodCall
+    void InlineMethods(std::unique_ptr<runtime::Executable>& program);
+
+    // Finds dotted paths (self.a.b.c) sharing a prefix of two or more ids inside straight-line code
+    // where nothing can change them: no calls, instance creation, operators that may call special
+    // methods, field stores or print. The first lookup stores the prefix value into a slot, later
+    // lookups start from the slot. Assignment to a variable only separates paths starting with it
+    void EliminateCommonPaths(std::unique_ptr<runtime::Executable>& program);
+
+    // Flow-insensitive inference of int, bool and str types for local variables and fields (a field
+    // name gets a type if every assignment to a field with this name in the program has it).
+    // Arithmetic, comparisons and string concatenations of proven types are replaced by typed nodes
+    // working on native values, see ast::UnboxedInt. Runs last, typed subtrees are final
+    void InferTypes(std::unique_ptr<runtime::Executable>& program);
+
+    // Sets runtime::Method::pure for methods that read no fields, print nothing, create no
+    // instances, store no fields and call only pure methods of self. Calls of such methods
+    // with value arguments are answered from runtime::MemoCache when the context has one.
+    // Runs before the passes that replace nodes, the analysis knows only the parsed ones
+    void MarkPureMethods(std::unique_ptr<runtime::Executable>& program);
+
+    // Escape analysis of intermediate results: a number, string or bool consumed by an operator,
+    // a condition, str() or print right away, with no call in between that could run the same node
+    // again, is kept in the node producing it instead of a new heap object (see ast::ReusableResult).
+    // Results stored into variables, fields, arguments or returned always get their own objects
+    void ReuseTemporaries(std::unique_ptr<runtime::Executable>& program);
+
+    // Runs all optimization passes over the parsed program
+    void OptimizeProgram(std::unique_ptr<runtime::Executable>& program);
+
+} // namespace optimize
@@ -0,0 +1,637 @@
+#include "jit.h"
+#include "lexer.h"
+#include "optimize.h"
+#include "parse.h"
+#include "statement.h"
+#include "test_runner_p.h"
+
+using namespace std;
+
+namespace optimize {
+
+    namespace {
+        unique_ptr<ast::Statement> ParseProgramFromString(const string& program) {
+            istringstream is(program);
+            parse::Lexer lexer(is);
+
+            return ParseProgram(lexer);
+        }
+
+        string RunProgram(ast::Statement& program, jit::Jit* jit = nullptr) {
+            runtime::DummyContext context;
+            context.SetMethodCompiler(jit);
+            runtime::Closure closure;
+            program.Execute(closure, context);
+
+            return context.output.str();
+        }
+
+        template <typename Node>
+        size_t CountNodes(unique_ptr<ast::Statement>& node) {
+            if (!node) {
+                return 0;
+            }
+
+            size_t count = dynamic_cast<Node*>(node.get()) != nullptr ? 1 : 0;
+            node->ForEachChild([&count](unique_ptr<ast::Statement>& child) {
+                count += CountNodes<Node>(child);
+            });
+
+            return count;
+        }
+
+        template <typename Node, typename Function>
+        void ForEachNode(unique_ptr<ast::Statement>& node, Function function) {
+            if (!node) {
+                return;
+            }
+
+            if (const auto* typed = dynamic_cast<const Node*>(node.get())) {
+                function(*typed);
+            }
+            node->ForEachChild([&function](unique_ptr<ast::Statement>& child) {
+                ForEachNode<Node>(child, function);
+            });
+        }
+
+        // Runs the program with and without optimization and checks that output is the same, then
+        // runs the optimized program again with compiled methods checked against the interpreter
+        string RunOptimized(const string& program_text, unique_ptr<ast::Statement>& program) {
+            auto reference = ParseProgramFromString(program_text);
+            string expected = RunProgram(*reference);
+
+            program = ParseProgramFromString(program_text);
+            OptimizeProgram(program);
+            string output = RunProgram(*program);
+
+            ASSERT_EQUAL(output, expected);
+
+            auto checked = ParseProgramFromString(program_text);
+            OptimizeProgram(checked);
+            jit::Jit jit(jit::Jit::Mode::Differential, 1);
+            ASSERT_EQUAL(RunProgram(*checked, &jit), expected);
+
+            return output;
+        }
+
+        void TestFieldIncrement() {
+            const string program = R"(
+class Money:
+  def __init__(amount):
+    self.amount = amount
+
+  def __add__(value):
+    self.amount = self.amount + value * 100
+    return self
+
+  def __str__():
+    return str(self.amount / 100) + ' USD'
+
+class Counter:
+  def __init__(value):
+    self.value = value
+
+  def add():
+    self.value = self.value + 1
+
+  def add_more():
+    self.value = 2 + self.value
+    self.value = self.value - 1
+
+c = Counter(0)
+c.add()
+c.add_more()
+c.add_more()
+print c.value
+m = Counter(Money(500))
+m.add()
+print m.value
+)"s;
+
+            unique_ptr<ast::Statement> tree;
+            ASSERT_EQUAL(RunOptimized(program, tree), "3\n6 USD\n"s);
+            // two more come from the inlined bodies of c.add() and m.add()
+            ASSERT_EQUAL(CountNodes<ast::FieldIncrement>(tree), 5U);
+        }
+
+        void TestFieldCopy() {
+            const string program = R"(
+class Point:
+  def __init__(x, y):
+    self.x = x
+    self.y = y
+
+  def swap():
+    tmp = self.x
+    self.x = self.y
+    self.y = tmp
+
+class Holder:
+  def __init__(point):
+    self.point = point
+    self.x = self.point.x
+
+p = Point(1, 2)
+p.swap()
+h = Holder(p)
+print p.x, p.y, h.x
+)"s;
+
+            unique_ptr<ast::Statement> tree;
+            ASSERT_EQUAL(RunOptimized(program, tree), "2 1 2\n"s);
+            ASSERT_EQUAL(CountNodes<ast::FieldCopy>(tree), 2U);
+        }
+
+        void TestSelfMethodCall() {
+            const string program = R"(
+class Greeter:
+  def greet(name, times):
+    if times > 0:
+      print 'hello,', name
+      self.greet(name, times - 1)
+
+  def run():
+    self.greet('world', 2)
+    self.greet('mython', 1)
+    x = self.value()
+    print x
+
+  def value():
+    return None
+
+g = Greeter()
+g.run()
+)"s;
+
+            unique_ptr<ast::Statement> tree;
+            ASSERT_EQUAL(RunOptimized(program, tree), "hello, world\nhello, world\nhello, mython\nNone\n"s);
+            // self.value() is inlined
+            ASSERT_EQUAL(CountNodes<ast::SelfMethodCall>(tree), 2U);
+            ASSERT_EQUAL(CountNodes<ast::InlinedMethodCall>(tree), 1U);
+        }
+
+        void TestTailCalls() {
+            const string program = R"(
+class Loop:
+  def sum(n, acc):
+    if n == 0:
+      return acc
+    tmp = acc + n
+    return self.sum(n - 1, tmp)
+
+class Verbose(Loop):
+  def sum(n, acc):
+    print 'n =', n
+    return acc
+
+loop = Loop()
+verbose = Verbose()
+print loop.sum(3, 0), verbose.sum(3, 0)
+)"s;
+
+            unique_ptr<ast::Statement> tree;
+            ASSERT_EQUAL(RunOptimized(program, tree), "6 n = 3\n0\n"s);
+            ASSERT_EQUAL(CountNodes<ast::TailCall>(tree), 1U);
+
+            // deep enough to overflow the native stack without frame reuse
+            auto deep = ParseProgramFromString(R"(
+class Loop:
+  def sum(n, acc):
+    if n == 0:
+      return acc
+    return self.sum(n - 1, acc + 2)
+
+loop = Loop()
+print loop.sum(200000, 0)
+)"s);
+            OptimizeProgram(deep);
+            ASSERT_EQUAL(RunProgram(*deep), "400000\n"s);
+        }
+
+        void TestInlineMethods() {
+            const string program = R"(
+class Point:
+  def __init__(x, y):
+    self.x = x
+    self.y = y
+
+  def get_x():
+    return self.x
+
+  def set_x(value):
+    self.x = value
+
+  def dist(other):
+    return (self.x - other.x) * (self.x - other.x) + (self.y - other.y) * (self.y - other.y)
+
+  def is_left_of(other):
+    return self.x < other.x
+
+  def describe():
+    print 'point', self.x
+    return self.y
+
+class Point3(Point):
+  def __init__(x, y, z):
+    self.x = x
+    self.y = y
+    self.z = z
+
+class Printer:
+  def show(point):
+    print point.get_x()
+
+p = Point(1, 2)
+q = Point(4, 6)
+print p.set_x(3)
+print p.get_x(), p.dist(q), p.is_left_of(q), q.is_left_of(p)
+
+printer = Printer()
+printer.show(p)
+r = Point3(7, 8, 9)
+printer.show(r)
+printer.show(q)
+)"s;
+
+            unique_ptr<ast::Statement> tree;
+            ASSERT_EQUAL(RunOptimized(program, tree), "None\n3 17 True False\n3\n7\n4\n"s);
+            ASSERT_EQUAL(CountNodes<ast::InlinedMethodCall>(tree), 6U);
+
+            // the call site in Printer.show has seen a Point3 receiver and went back to the original call
+            size_t deoptimized = 0;
+            ForEachNode<ast::InlinedMethodCall>(tree, [&deoptimized](const ast::InlinedMethodCall& call) {
+                deoptimized += call.IsDeoptimized() ? 1 : 0;
+            });
+            ASSERT_EQUAL(deoptimized, 1U);
+        }
+
+        void TestInferTypes() {
+            const string program = R"(
+class Counter:
+  def __init__():
+    self.count = 0
+    self.label = 'counter'
+
+  def step(n):
+    i = 0
+    while i < n:
+      self.count = self.count + i * 2 - 1
+      i = i + 1
+    return self.label + ': ' + str(self.count)
+
+c = Counter()
+print c.step(10)
+x = 6
+x = x + 1
+y = x * 3 + 1
+print y, y / 2, x > y
+text = 'y=' + str(y)
+print text
+)"s;
+
+            unique_ptr<ast::Statement> tree;
+            ASSERT_EQUAL(RunOptimized(program, tree), "counter: 80\n22 11 False\ny=22\n"s);
+            ASSERT_EQUAL(CountNodes<ast::UnboxedInt>(tree), 5U);
+            ASSERT_EQUAL(CountNodes<ast::StringConcat>(tree), 2U);
+            // i < n is not typed, n is a parameter
+            ASSERT_EQUAL(CountNodes<ast::UnboxedComparison<ast::compare::Greater>>(tree), 1U);
+            ASSERT_EQUAL(CountNodes<ast::UnboxedComparison<ast::compare::Less>>(tree), 0U);
+
+            // s.count reads s itself, the typed node falls back to the original expression
+            auto mismatch = ParseProgramFromString(R"(
+class Counter:
+  def __init__():
+    self.count = 0
+
+c = Counter()
+s = 'abc'
+print c.count + s.count
+)"s);
+            OptimizeProgram(mismatch);
+            ASSERT_EQUAL(CountNodes<ast::UnboxedInt>(mismatch), 1U);
+            ASSERT_THROWS(RunProgram(*mismatch), std::runtime_error);
+        }
+
+        void TestEliminateDeadCode() {
+            const string program = R"(
+DEBUG = False
+LIMIT = 3
+
+class Logger:
+  def log(msg):
+    print 'log:', msg
+
+class Unused:
+  def run():
+    print 'never'
+
+class Base:
+  def __str__():
+    return 'Base'
+
+  def helper():
+    return 1
+
+class Shape(Base):
+  def area(n):
+    limit = 10
+    if n > limit:
+      return limit
+    return n
+    print 'unreachable'
+
+s = Shape()
+if DEBUG:
+  logger = Logger()
+  logger.log('debug')
+else:
+  print 'release', LIMIT * 2 + 1
+while DEBUG and True:
+  print 'never'
+print s.area(12), s.area(LIMIT), s
+)"s;
+
+            unique_ptr<ast::Statement> tree;
+            ASSERT_EQUAL(RunOptimized(program, tree), "release 7\n10 3 Base\n"s);
+
+            // Logger is used only in the dead branch
+            ASSERT_EQUAL(CountNodes<ast::ClassDefinition>(tree), 2U);
+            ASSERT_EQUAL(CountNodes<ast::IfElse>(tree), 1U);
+            ASSERT_EQUAL(CountNodes<ast::While>(tree), 0U);
+            ASSERT_EQUAL(CountNodes<ast::Print>(tree), 2U);
+
+            ForEachNode<ast::ClassDefinition>(tree, [](const ast::ClassDefinition& definition) {
+                for (const auto& method : definition.GetClass().Methods()) {
+                    ASSERT_EQUAL(method.body == nullptr, method.name == "helper"s);
+                }
+            });
+        }
+
+        void TestEliminateCommonPaths() {
+            const string program = R"(
+class Vec:
+  def __init__(x, y):
+    self.x = x
+    self.y = y
+
+class Body2:
+  def __init__():
+    self.size = Vec(5, 6)
+
+class Body:
+  def __init__():
+    self.pos = Vec(1, 2)
+    self.vel = Vec(3, 4)
+    self.shape = Body2()
+
+  def step():
+    self.pos.x = self.pos.x + self.vel.x
+
+  def energy():
+    vx = self.vel.x
+    vy = self.vel.y
+    w = self.shape.size.x
+    h = self.shape.size.y
+    return vx * vx + vy * vy + w * h
+
+  def moved():
+    old = self.pos.x
+    self.move()
+    return self.pos.x - old
+
+  def move():
+    self.pos.x = self.pos.x + 10
+
+  def stored():
+    a = self.pos.x
+    self.pos.x = 7
+    b = self.pos.x
+    return a * 100 + b
+
+  def reassigned():
+    v = self.vel
+    a = v.x
+    v = self.pos
+    b = v.x
+    return a * 100 + b
+
+body = Body()
+body.step()
+print body.energy(), body.moved(), body.stored(), body.reassigned()
+)"s;
+
+            unique_ptr<ast::Statement> tree;
+            ASSERT_EQUAL(RunOptimized(program, tree), "55 10 1407 307\n"s);
+
+            // self.vel.y and self.shape.size.y start from the prefixes cached by the lookups before them
+            vector<size_t> prefixes;
+            ForEachNode<ast::VariableValue>(tree, [&prefixes](const ast::VariableValue& var) {
+                if (var.GetUsedPrefixLength() > 0) {
+                    prefixes.push_back(var.GetUsedPrefixLength());
+                }
+            });
+            sort(prefixes.begin(), prefixes.end());
+            ASSERT_EQUAL(prefixes, (vector<size_t>{ 2, 3 }));
+        }
+
+        // the cached prefix isn't kept after its last use, it would keep the node from the collector
+        void TestCommonPathsReleaseSlots() {
+            auto program = ParseProgramFromString(R"(
+class Node:
+  def __init__(value):
+    self.me = self
+    self.value = value
+
+class Box:
+  def __init__():
+    self.node = Node(3)
+
+class Reader:
+  def read(box):
+    return box.node.value * box.node.value + box.node.me.value
+
+r = Reader()
+b = Box()
+print r.read(b)
+b = None
+)"s);
+            OptimizeProgram(program);
+
+            size_t used_prefixes = 0;
+            ForEachNode<ast::VariableValue>(program, [&used_prefixes](const ast::VariableValue& var) {
+                used_prefixes += var.GetUsedPrefixLength() > 0 ? 1 : 0;
+            });
+            ASSERT(used_prefixes > 0U);
+
+            runtime::GarbageCollector collector;
+            {
+                runtime::DummyContext context;
+                runtime::Closure closure;
+                program->Execute(closure, context);
+                ASSERT_EQUAL(context.output.str(), "12\n"s);
+            }
+
+            // only the node cycle is left, nothing refers to it from outside
+            ASSERT_EQUAL(collector.Collect(true), 1U);
+            ASSERT_EQUAL(collector.GetTracked(), 0U);
+        }
+
+        // A run in a region as the interpreter makes it: the tree is made before the region and
+        // destroyed before it, the cached path prefixes may still hold values of the run
+        void TestRunInRegion() {
+            const string program_text = R"(
+class Leaf:
+  def __init__(v):
+    self.v = v
+    self.w = v + 1
+
+class Mid:
+  def __init__(leaf):
+    self.leaf = leaf
+
+class Top:
+  def __init__(mid):
+    self.mid = mid
+
+t = Top(Mid(Leaf(5)))
+x = t.mid.leaf.v - t.mid.leaf.w
+print x, t.mid.leaf.v * t.mid.leaf.w
+y = t.mid.leaf.v / 0 - t.mid.leaf.w
+)"s;
+
+            ostringstream output;
+            {
+                optional<runtime::Region> region;
+                auto program = ParseProgramFromString(program_text);
+                OptimizeProgram(program);
+                region.emplace();
+
+                runtime::SimpleContext context{ output };
+                runtime::Closure closure;
+                // the division leaves the prefix of the second lookup in its slot
+                ASSERT_THROWS(program->Execute(closure, context), std::runtime_error);
+            }
+
+            ASSERT_EQUAL(output.str(), "-1 30\n"s);
+        }
+
+        void TestReuseTemporaries() {
+            const string program = R"(
+class R:
+  def f(n):
+    if n == 0:
+      return 0
+    return n * 2 - self.f(n - 1)
+
+  def g(a, b):
+    return (a - b) * (a + b) + 1
+
+  def h(s, n):
+    print s + str(n * 3), n * n > 10
+    return s + '!'
+
+r = R()
+print r.f(5), r.g(7, 3)
+x = r.h('x', 4)
+print x
+)"s;
+
+            unique_ptr<ast::Statement> tree;
+            ASSERT_EQUAL(RunOptimized(program, tree), "6 41\nx12 True\nx!\n"s);
+
+            // n * 2 waits for a recursive call and a - b for a + b, which may run __add__: both get new objects
+            size_t reused = 0;
+            ForEachNode<ast::ReusableResult>(tree, [&reused](const ast::ReusableResult& result) {
+                reused += result.IsResultReused() ? 1 : 0;
+            });
+            ASSERT_EQUAL(reused, 7U);
+        }
+
+        void TestMarkPureMethods() {
+            const string program = R"(
+class Calc:
+  def __init__():
+    self.calls = 0
+
+  def fib(n):
+    if n < 2:
+      return n
+    return self.fib(n - 1) + self.fib(n - 2)
+
+  def label(n):
+    return 'fib(' + str(n) + ') = '
+
+  def counted(n):
+    self.calls = self.calls + 1
+    return n
+
+  def twice(n):
+    return self.counted(n) + self.counted(n)
+
+  def shout(s):
+    print s
+    return s
+
+  def size(calc):
+    return calc.calls
+
+c = Calc()
+print c.label(25) + str(c.fib(25))
+print c.twice(2), c.calls
+x = c.shout('hi')
+x = c.shout('hi')
+print c.size(c)
+)"s;
+            const string expected = "fib(25) = 75025\n4 2\nhi\nhi\n2\n"s;
+
+            unique_ptr<ast::Statement> tree;
+            ASSERT_EQUAL(RunOptimized(program, tree), expected);
+
+            set<string> pure;
+            ForEachNode<ast::ClassDefinition>(tree, [&pure](const ast::ClassDefinition& definition) {
+                for (const auto& method : definition.GetClass().Methods()) {
+                    if (method.pure) {
+                        pure.insert(method.name);
+                    }
+                }
+            });
+            ASSERT_EQUAL(pure, (set<string>{ "fib"s, "label"s }));
+
+            for (size_t capacity : { runtime::MemoCache::DEFAULT_CAPACITY, size_t{ 2 } }) {
+                tree = ParseProgramFromString(program);
+                OptimizeProgram(tree);
+
+                runtime::MemoCache memo_cache(capacity);
+                runtime::DummyContext context;
+                context.SetMemoCache(&memo_cache);
+
+                runtime::Closure closure;
+                tree->Execute(closure, context);
+                ASSERT_EQUAL(context.output.str(), expected);
+                ASSERT(memo_cache.GetSize() <= capacity);
+
+                // fib(n) is computed once for every n, fib(n - 2) is found in the cache
+                if (capacity == runtime::MemoCache::DEFAULT_CAPACITY) {
+                    ASSERT(memo_cache.GetHits() >= 23U);
+                    ASSERT(memo_cache.GetMisses() <= 27U);
+                }
+            }
+        }
+    } // namespace
+
+    void RunOptimizeTests(TestRunner& tr) {
+        RUN_TEST(tr, optimize::TestFieldIncrement);
+        RUN_TEST(tr, optimize::TestFieldCopy);
+        RUN_TEST(tr, optimize::TestSelfMethodCall);
+        RUN_TEST(tr, optimize::TestTailCalls);
+        RUN_TEST(tr, optimize::TestInlineMethods);
+        RUN_TEST(tr, optimize::TestInferTypes);
+        RUN_TEST(tr, optimize::TestEliminateDeadCode);
+        RUN_TEST(tr, optimize::TestEliminateCommonPaths);
+        RUN_TEST(tr, optimize::TestCommonPathsReleaseSlots);
+        RUN_TEST(tr, optimize::TestRunInRegion);
+        RUN_TEST(tr, optimize::TestReuseTemporaries);
+        RUN_TEST(tr, optimize::TestMarkPureMethods);
+    }
+
+} // namespace optimize
@@ -3,6 +3,8 @@
 #include "lexer.h"
 #include "statement.h"
 
+#include <utility>
+
 using namespace std;
 
 namespace TokenType = parse::token_type;
@@ -74,7 +76,10 @@ namespace {
                 lexer_.ExpectNext<TokenType::Char>(':');
                 lexer_.NextToken();
 
+                // break and continue can't leave a method
+                int outer_loop_depth = std::exchange(loop_depth_, 0);
                 m.body = std::make_unique<ast::MethodBody>(ParseSuite());
+                loop_depth_ = outer_loop_depth;
 
                 result.push_back(std::move(m));
             }
@@ -227,7 +232,7 @@ namespace {
                 return make_unique<ast::Mult>(ParseMult(), make_unique<ast::NumericConst>(-1));
             }
             if (const auto* num = lexer_.CurrentToken().TryAs<TokenType::Number>()) {
-                int result = num->value;
+                std::int64_t result = num->value;
                 lexer_.NextToken();
 
                 return make_unique<ast::NumericConst>(result);
@@ -331,6 +336,23 @@ namespace {
                                             std::move(else_body));
         }
 
+        // Loop -> while LogicalExpr: Suite
+        unique_ptr<ast::Statement> ParseLoop() {
+            lexer_.Expect<TokenType::While>();
+            lexer_.NextToken();
+
+            auto condition = ParseTest();
+
+            lexer_.Expect<TokenType::Char>(':');
+            lexer_.NextToken();
+
+            ++loop_depth_;
+            auto body = ParseSuite();
+            --loop_depth_;
+
+            return make_unique<ast::While>(std::move(condition), std::move(body));
+        }
+
         // LogicalExpr -> AndTest [OR AndTest]
         // AndTest -> NotTest [AND NotTest]
         // NotTest -> [NOT] NotTest
@@ -373,38 +395,32 @@ namespace {
 
             if (tok == '<') {
                 lexer_.NextToken();
-                return make_unique<ast::Comparison>(runtime::Less, std::move(result),
-                                                    ParseExpression());
+                return make_unique<ast::LessComparison>(std::move(result), ParseExpression());
             }
 
             if (tok == '>') {
                 lexer_.NextToken();
-                return make_unique<ast::Comparison>(runtime::Greater, std::move(result),
-                                                    ParseExpression());
+                return make_unique<ast::GreaterComparison>(std::move(result), ParseExpression());
             }
 
             if (tok.Is<TokenType::Eq>()) {
                 lexer_.NextToken();
-                return make_unique<ast::Comparison>(runtime::Equal, std::move(result),
-                                                    ParseExpression());
+                return make_unique<ast::EqualComparison>(std::move(result), ParseExpression());
             }
 
             if (tok.Is<TokenType::NotEq>()) {
                 lexer_.NextToken();
-                return make_unique<ast::Comparison>(runtime::NotEqual, std::move(result),
-                                                    ParseExpression());
+                return make_unique<ast::NotEqualComparison>(std::move(result), ParseExpression());
             }
 
             if (tok.Is<TokenType::LessOrEq>()) {
                 lexer_.NextToken();
-                return make_unique<ast::Comparison>(runtime::LessOrEqual, std::move(result),
-                                                    ParseExpression());
+                return make_unique<ast::LessOrEqualComparison>(std::move(result), ParseExpression());
             }
 
             if (tok.Is<TokenType::GreaterOrEq>()) {
                 lexer_.NextToken();
-                return make_unique<ast::Comparison>(runtime::GreaterOrEqual, std::move(result),
-                                                    ParseExpression());
+                return make_unique<ast::GreaterOrEqualComparison>(std::move(result), ParseExpression());
             }
 
             return result;
@@ -413,6 +429,7 @@ namespace {
         // Statement -> SimpleStatement Newline
         //           | class ClassDefinition
         //           | if Condition
+        //           | while Loop
         unique_ptr<ast::Statement> ParseStatement() {
             const auto& tok = lexer_.CurrentToken();
 
@@ -425,6 +442,10 @@ namespace {
                 return ParseCondition();
             }
 
+            if (tok.Is<TokenType::While>()) {
+                return ParseLoop();
+            }
+
             auto result = ParseSimpleStatement();
             lexer_.Expect<TokenType::Newline>();
             lexer_.NextToken();
@@ -434,6 +455,8 @@ namespace {
 
         // StatementBody -> return Expression
         //               | print ExpressionList
+        //               | break
+        //               | continue
         //               | AssignmentOrCall
         unique_ptr<ast::Statement> ParseSimpleStatement() {
             const auto& tok = lexer_.CurrentToken();
@@ -454,11 +477,26 @@ namespace {
                 return make_unique<ast::Print>(std::move(args));
             }
 
+            if (tok.Is<TokenType::Break>() || tok.Is<TokenType::Continue>()) {
+                if (loop_depth_ == 0) {
+                    throw ParseError(tok.Is<TokenType::Break>() ? "'break' outside loop"s : "'continue' outside loop"s);
+                }
+
+                bool is_break = tok.Is<TokenType::Break>();
+                lexer_.NextToken();
+
+                if (is_break) {
+                    return make_unique<ast::Break>();
+                }
+                return make_unique<ast::Continue>();
+            }
+
             return ParseAssignmentOrCall();
         }
 
         parse::Lexer& lexer_;
         runtime::Closure declared_classes_;
+        int loop_depth_ = 0;
     };
 
 } // namespace
@@ -1,4 +1,6 @@
+#include "jit.h"
 #include "lexer.h"
+#include "optimize.h"
 #include "parse.h"
 #include "statement.h"
 #include "test_runner_p.h"
@@ -14,6 +16,21 @@ namespace parse {
         return ParseProgram(lexer);
     }
 
+    // Runs the optimized program with every hot method compiled and checked against the interpreter
+    string RunDifferential(const string& program) {
+        auto tree = ParseProgramFromString(program);
+        optimize::OptimizeProgram(tree);
+
+        jit::Jit jit(jit::Jit::Mode::Differential, 1);
+        runtime::DummyContext context;
+        context.SetMethodCompiler(&jit);
+
+        runtime::Closure closure;
+        tree->Execute(closure, context);
+
+        return context.output.str();
+    }
+
     void TestSimpleProgram() {
         const string program = R"(
 x = 4
@@ -30,6 +47,7 @@ print x + y, z + n
         tree->Execute(closure, context);
 
         ASSERT_EQUAL(context.output.str(), "9 hello, world\n"s);
+        ASSERT_EQUAL(RunDifferential(program), context.output.str());
     }
 
     void TestSimpleProgram2() {
@@ -51,6 +69,7 @@ print "9 hello, world"
         tree->Execute(closure, context);
 
         ASSERT_EQUAL(context.output.str(), "9 hello, world\n"s);
+        ASSERT_EQUAL(RunDifferential(program), context.output.str());
     }
 
     void TestProgramWithClasses() {
@@ -89,6 +108,7 @@ print program_name, origin, far_far_away, origin.SetX(1)
         tree->Execute(closure, context);
 
         ASSERT_EQUAL(context.output.str(), "Classes test (0; 0) (10000; 50000) None\n"s);
+        ASSERT_EQUAL(RunDifferential(program), context.output.str());
     }
 
     void TestProgramWithIf() {
@@ -115,6 +135,7 @@ else:
         tree->Execute(closure, context);
 
         ASSERT_EQUAL(context.output.str(), "x <= y\ny >= 0\n"s);
+        ASSERT_EQUAL(RunDifferential(program), context.output.str());
     }
 
     void TestReturnFromIf() {
@@ -137,6 +158,7 @@ print x.calc(2)
         tree->Execute(closure, context);
 
         ASSERT_EQUAL(context.output.str(), "2\n"s);
+        ASSERT_EQUAL(RunDifferential(program), context.output.str());
     }
 
     void TestRecursion() {
@@ -164,6 +186,7 @@ print x.result
         tree->Execute(closure, context);
 
         ASSERT_EQUAL(context.output.str(), "55\n"s);
+        ASSERT_EQUAL(RunDifferential(program), context.output.str());
     }
 
     void TestRecursion2() {
@@ -193,6 +216,7 @@ print x.call_count
         tree->Execute(closure, context);
 
         ASSERT_EQUAL(context.output.str(), "17\n1\n115\n"s);
+        ASSERT_EQUAL(RunDifferential(program), context.output.str());
     }
 
     void TestComplexLogicalExpression() {
@@ -211,6 +235,7 @@ print ok
         tree->Execute(closure, context);
 
         ASSERT_EQUAL(context.output.str(), "False\n"s);
+        ASSERT_EQUAL(RunDifferential(program), context.output.str());
     }
 
     void TestClassicalPolymorphism() {
@@ -264,6 +289,124 @@ print r, c, t1, t2
 
         ASSERT_EQUAL(context.output.str(),
                      "Rect(10x20) Circle(52) Triangle(3, 4, 5) Wrong triangle\n"s);
+        ASSERT_EQUAL(RunDifferential(program), context.output.str());
+    }
+
+    void TestWhileLoop() {
+        const string program = R"(
+class Collatz:
+  def steps(n):
+    count = 0
+    while n != 1:
+      count = count + 1
+      if n - n / 2 * 2 == 0:
+        n = n / 2
+        continue
+      n = 3 * n + 1
+    return count
+
+c = Collatz()
+i = 0
+total = 0
+while True:
+  i = i + 1
+  if i > 10:
+    break
+  if i == 5:
+    continue
+  total = total + c.steps(i)
+print total, i
+)"s;
+
+        runtime::DummyContext context;
+
+        runtime::Closure closure;
+        auto tree = ParseProgramFromString(program);
+        tree->Execute(closure, context);
+
+        ASSERT_EQUAL(context.output.str(), "62 11\n"s);
+        ASSERT_EQUAL(RunDifferential(program), context.output.str());
+
+        ASSERT_THROWS(ParseProgramFromString("break\n"s), ParseError);
+        ASSERT_THROWS(ParseProgramFromString(R"(
+while True:
+  class Breaker:
+    def run():
+      break
+)"s), ParseError);
+    }
+
+    void TestDeepRecursion() {
+        const string program = R"(
+class Counter:
+  def depth(n):
+    if n == 0:
+      return 0
+    return self.depth(n - 1) + 1
+
+c = Counter()
+print c.depth(100000)
+)"s;
+
+        runtime::CallStack call_stack;
+        runtime::DummyContext context;
+        context.SetCallStack(&call_stack);
+
+        runtime::Closure closure;
+        auto tree = ParseProgramFromString(program);
+        call_stack.Run([&] {
+            tree->Execute(closure, context);
+        });
+
+        ASSERT_EQUAL(context.output.str(), "100000\n"s);
+        ASSERT_EQUAL(call_stack.GetDepth(), 0U);
+
+        const string endless = R"(
+class Endless:
+  def run(n):
+    return self.run(n + 1) + 1
+
+e = Endless()
+print e.run(0)
+)"s;
+
+        runtime::CallStack small_stack(16 * 1024 * 1024);
+        runtime::DummyContext endless_context;
+        endless_context.SetCallStack(&small_stack);
+
+        runtime::Closure endless_closure;
+        auto endless_tree = ParseProgramFromString(endless);
+        ASSERT_THROWS(small_stack.Run([&] {
+            endless_tree->Execute(endless_closure, endless_context);
+        }),
+                      runtime::StackOverflowError);
+        ASSERT_EQUAL(small_stack.GetDepth(), 0U);
+    }
+
+    void TestLongList() {
+        const string program = R"(
+class Node:
+  def __init__(next):
+    self.next = next
+
+head = None
+i = 0
+while i < 300000:
+  head = Node(head)
+  i = i + 1
+print "built"
+)"s;
+
+        runtime::DummyContext context;
+
+        // the list goes with the closure on the stack of the test, it's released without recursion
+        {
+            runtime::Closure closure;
+            auto tree = ParseProgramFromString(program);
+            tree->Execute(closure, context);
+        }
+
+        ASSERT_EQUAL(context.output.str(), "built\n"s);
     }
 
 } // namespace parse
@@ -278,4 +421,7 @@ void TestParseProgram(TestRunner& tr) {
     RUN_TEST(tr, parse::TestRecursion2);
     RUN_TEST(tr, parse::TestComplexLogicalExpression);
     RUN_TEST(tr, parse::TestClassicalPolymorphism);
+    RUN_TEST(tr, parse::TestWhileLoop);
+    RUN_TEST(tr, parse::TestDeepRecursion);
+    RUN_TEST(tr, parse::TestLongList);
 }
\ No newline at end of file
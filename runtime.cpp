@@ -1,9 +1,15 @@
 #include "runtime.h"
 
+#include <algorithm>
 #include <cassert>
 #include <iostream>
 #include <optional>
 #include <sstream>
+#include <utility>
+
+#include <sys/mman.h>
+#include <ucontext.h>
+#include <unistd.h>
 
 using namespace std;
 
@@ -16,16 +22,118 @@ namespace {
 
 namespace runtime {
 
-    ObjectHolder::ObjectHolder(std::shared_ptr<Object> data)
-        : data_(std::move(data)) {
+    namespace {
+        // Blocks of sizes rounded up to GRANULE, carved from chunks. A freed block goes to the free
+        // list of its size class and is the next one allocated from it. Chunks are linked through
+        // their first block and never released but by a region, so objects may be freed at any
+        // time, also during the destruction of static objects
+        class ObjectPool {
+        public:
+            static constexpr size_t GRANULE = 16;
+            static constexpr size_t MAX_POOLED_SIZE = 256;
+            static constexpr size_t CHUNK_SIZE = 64 * 1024;
+
+            void* Allocate(size_t size) {
+                if (size > MAX_POOLED_SIZE) {
+                    return ::operator new(size);
+                }
+
+                FreeBlock*& free_list = free_lists_[ClassIndex(size)];
+
+                if (free_list != nullptr) {
+                    return std::exchange(free_list, free_list->next);
+                }
+
+                return Carve((ClassIndex(size) + 1) * GRANULE);
+            }
+
+            void Deallocate(void* block, size_t size) noexcept {
+                if (size > MAX_POOLED_SIZE) {
+                    ::operator delete(block);
+                    return;
+                }
+
+                FreeBlock*& free_list = free_lists_[ClassIndex(size)];
+                free_list = new (block) FreeBlock{ free_list };
+            }
+
+            // Whether the block was carved from a chunk of the pool
+            bool Owns(const void* block) const {
+                const char* address = static_cast<const char*>(block);
+
+                for (const FreeBlock* chunk = chunks_; chunk != nullptr; chunk = chunk->next) {
+                    const char* start = reinterpret_cast<const char*>(chunk);
+                    if (address >= start && address < start + CHUNK_SIZE) {
+                        return true;
+                    }
+                }
+                return false;
+            }
+
+            // Returns the chunks to the global allocator, no block carved from them may be used after
+            void ReleaseChunks() noexcept {
+                while (chunks_ != nullptr) {
+                    ::operator delete(std::exchange(chunks_, chunks_->next));
+                }
+
+                std::fill(std::begin(free_lists_), std::end(free_lists_), nullptr);
+                chunk_next_ = nullptr;
+                chunk_end_ = nullptr;
+            }
+
+        private:
+            struct FreeBlock {
+                FreeBlock* next;
+            };
+
+            static size_t ClassIndex(size_t size) {
+                return (size + GRANULE - 1) / GRANULE - 1;
+            }
+
+            void* Carve(size_t block_size) {
+                if (chunk_end_ - chunk_next_ < static_cast<ptrdiff_t>(block_size)) {
+                    char* chunk = static_cast<char*>(::operator new(CHUNK_SIZE));
+                    chunks_ = new (chunk) FreeBlock{ chunks_ };
+                    chunk_next_ = chunk + GRANULE;
+                    chunk_end_ = chunk + CHUNK_SIZE;
+                }
+
+                return std::exchange(chunk_next_, chunk_next_ + block_size);
+            }
+
+            FreeBlock* free_lists_[MAX_POOLED_SIZE / GRANULE] = {};
+            FreeBlock* chunks_ = nullptr;
+            char* chunk_next_ = nullptr;
+            char* chunk_end_ = nullptr;
+        };
+
+        // trivially destructible, the pool outlives every object of the thread
+        thread_local ObjectPool object_pool;
+    } // namespace
+
+    void* Object::operator new(std::size_t size) {
+        return object_pool.Allocate(size);
     }
 
+    void Object::operator delete(void* object, std::size_t size) noexcept {
+        object_pool.Deallocate(object, size);
+    }
+
+    // The state of the thread pool before the region
+    class Region::Pool : public ObjectPool {
+    };
+
     void ObjectHolder::AssertIsValid() const {
-        assert(data_ != nullptr);
+        assert(*this);
     }
 
     ObjectHolder ObjectHolder::Share(Object& object) {
-        return ObjectHolder(std::shared_ptr<Object>(&object, [](auto* /*p*/) { /* do nothing */ }));
+        if (object.IsBorrowed()) {
+            return ObjectHolder(&object, Kind::Borrowed);
+        }
+
+        object.Retain();
+        return ObjectHolder(&object, Kind::Counted);
     }
 
     ObjectHolder ObjectHolder::None() {
@@ -42,44 +150,242 @@ namespace runtime {
         return Get();
     }
 
-    Object* ObjectHolder::Get() const {
-        return data_.get();
+    // Tagged types are tried by the holder, so only the member of its kind is read
+    bool IsTrue(const ObjectHolder& object) {
+        if (const auto* boolean = object.TryAs<Bool>()) {
+            return boolean->GetValue();
+        }
+        if (const auto* number = object.TryAs<Number>()) {
+            return number->GetValue() != 0;
+        }
+        if (const auto* string = object.TryAs<String>()) {
+            return string->GetSize() != 0;
+        }
+        if (object.TryAs<BigNumber>() != nullptr) {
+            // zero is always a Number
+            return true;
+        }
+        if (const auto* ptr_vo_bool = object.TryAs<runtime::ValueObject<bool>>()) {
+            return ptr_vo_bool->GetValue();
+        }
+        return false;
+    }
+
+    struct String::Rope {
+        ObjectHolder lhs;
+        ObjectHolder rhs;
+    };
+
+    String::String(std::string value)
+        : Object(ObjectType::String)
+        , value_(std::move(value))
+        , size_(value_.size()) {
     }
 
-    ObjectHolder::operator bool() const {
-        return Get() != nullptr;
+    // a copy of an interned string isn't interned
+    String::String(const String& other)
+        : Object(other)
+        , value_(other.GetValue())
+        , size_(other.size_)
+        , hash_(other.hash_)
+        , has_hash_(other.has_hash_) {
     }
 
-    bool IsTrue(const ObjectHolder& object) {
-        if (!object) {
-            return false;
+    String::String(String&& other) noexcept
+        : Object(other)
+        , value_(std::move(other.value_))
+        , rope_(std::move(other.rope_))
+        , size_(std::exchange(other.size_, 0))
+        , hash_(other.hash_)
+        , has_hash_(std::exchange(other.has_hash_, false)) {
+    }
+
+    String& String::operator=(String other) noexcept {
+        ReleaseRope();
+        value_ = std::move(other.value_);
+        rope_ = std::move(other.rope_);
+        size_ = other.size_;
+        hash_ = other.hash_;
+        has_hash_ = other.has_hash_;
+
+        return *this;
+    }
+
+    namespace {
+        struct InternedKey {
+            std::string_view value;
+            size_t hash;
+
+            bool operator==(const InternedKey& other) const {
+                return value == other.value;
+            }
+        };
+
+        struct InternedKeyHash {
+            size_t operator()(const InternedKey& key) const {
+                return key.hash;
+            }
+        };
+
+        using InternedStrings = std::unordered_map<InternedKey, String*, InternedKeyHash>;
+
+        // Made on the first use and never destroyed, interned strings held by static objects are
+        // destroyed after the thread storage
+        InternedStrings& GetInternedStrings() {
+            thread_local InternedStrings* strings = nullptr;
+
+            if (strings == nullptr) {
+                strings = new InternedStrings();
+            }
+            return *strings;
         }
+    } // namespace
 
-        auto ptr_b = object.TryAs<runtime::Bool>();
-        if (ptr_b != nullptr) {
-            return ptr_b->GetValue();
+    String::~String() {
+        if (interned_) {
+            GetInternedStrings().erase(InternedKey{ value_, hash_ });
         }
+        ReleaseRope();
+    }
+
+    // The thread pool starts anew in a region, so the region has chunks and free lists of its own.
+    // An object made before the region and freed in it goes to the free lists of the region, the
+    // block is dropped with the region then
+    Region::Region()
+        : previous_(std::make_unique<Pool>()) {
+        static_cast<ObjectPool&>(*previous_) = std::exchange(object_pool, ObjectPool{});
+    }
 
-        auto ptr_n = object.TryAs<runtime::Number>();
-        if (ptr_n != nullptr) {
-            return ptr_n->GetValue() != 0;
+    Region::~Region() {
+        // strings interned in the region leave the table, nothing else outside refers to it
+        auto& strings = GetInternedStrings();
+        for (auto it = strings.begin(); it != strings.end();) {
+            if (object_pool.Owns(it->second)) {
+                it = strings.erase(it);
+            } else {
+                ++it;
+            }
         }
 
-        auto ptr_s = object.TryAs<runtime::String>();
-        if (ptr_s != nullptr) {
-            if (ptr_s->GetValue() == ""s) {
-                return false;
+        object_pool.ReleaseChunks();
+        object_pool = *previous_;
+    }
+
+    void* Region::Allocate(std::size_t size) {
+        return object_pool.Allocate(size);
+    }
+
+    ObjectHolder String::Intern(std::string value) {
+        auto& strings = GetInternedStrings();
+        const size_t hash = std::hash<std::string_view>{}(value);
+
+        if (auto it = strings.find(InternedKey{ value, hash }); it != strings.end()) {
+            return ObjectHolder::Share(*it->second);
+        }
+
+        auto result = ObjectHolder::Own(String{ std::move(value) });
+        auto& string = *result.TryAs<String>();
+        string.hash_ = hash;
+        string.has_hash_ = true;
+        string.interned_ = true;
+        strings.emplace(InternedKey{ string.value_, hash }, &string);
+
+        return result;
+    }
+
+    size_t String::GetHash() const {
+        if (!has_hash_) {
+            hash_ = std::hash<std::string_view>{}(GetValue());
+            has_hash_ = true;
+        }
+        return hash_;
+    }
+
+    bool operator==(const String& lhs, const String& rhs) {
+        if (&lhs == &rhs) {
+            return true;
+        }
+        if ((lhs.IsInterned() && rhs.IsInterned()) || lhs.GetSize() != rhs.GetSize()) {
+            return false;
+        }
+        return lhs.GetValue() == rhs.GetValue();
+    }
+
+    ObjectHolder String::Concat(const ObjectHolder& lhs, const ObjectHolder& rhs) {
+        const auto& lhs_string = *lhs.TryAs<String>();
+        const auto& rhs_string = *rhs.TryAs<String>();
+        const size_t size = lhs_string.size_ + rhs_string.size_;
+
+        if (size < ROPE_THRESHOLD) {
+            return ObjectHolder::Own(String{ lhs_string.GetValue() + rhs_string.GetValue() });
+        }
+
+        auto keep = [](const ObjectHolder& holder, const String& string) {
+            return string.IsBorrowed() ? ObjectHolder::Own(String{ string }) : holder;
+        };
+
+        String result{ std::string() };
+        result.rope_ = std::make_unique<Rope>(Rope{ keep(lhs, lhs_string), keep(rhs, rhs_string) });
+        result.size_ = size;
+
+        return ObjectHolder::Own(std::move(result));
+    }
+
+    void String::Print(std::ostream& os, [[maybe_unused]] Context& context) {
+        os << GetValue();
+    }
+
+    void String::Flatten() const {
+        std::string value;
+        value.reserve(size_);
+
+        // leaves from left to right, the right part of a rope waits on the stack
+        std::vector<const String*> pending{ this };
+
+        while (!pending.empty()) {
+            const String* string = pending.back();
+            pending.pop_back();
+
+            if (string->rope_) {
+                pending.push_back(string->rope_->rhs.TryAs<String>());
+                pending.push_back(string->rope_->lhs.TryAs<String>());
             } else {
-                return true;
+                value += string->value_;
             }
         }
 
-        auto ptr_vo_bool = object.TryAs<runtime::ValueObject<bool>>();
-        if (ptr_vo_bool != nullptr) {
-            return ptr_vo_bool->GetValue();
+        value_ = std::move(value);
+        ReleaseRope();
+    }
+
+    void String::ReleaseRope() const noexcept {
+        if (!rope_) {
+            return;
         }
 
-        return false;
+        std::vector<ObjectHolder> pending;
+        pending.push_back(std::move(rope_->lhs));
+        pending.push_back(std::move(rope_->rhs));
+        rope_.reset();
+
+        while (!pending.empty()) {
+            ObjectHolder part = std::move(pending.back());
+            pending.pop_back();
+
+            // the last reference to a rope: take its parts, so it's destroyed without them
+            if (auto* string = part.TryAs<String>(); string != nullptr && string->rope_ && part.IsUnique()) {
+                pending.push_back(std::move(string->rope_->lhs));
+                pending.push_back(std::move(string->rope_->rhs));
+                string->rope_.reset();
+            }
+        }
+    }
+
+    bool Executable::ExecuteCondition(Closure& closure, Context& context) {
+        return IsTrue(Execute(closure, context));
+    }
+
+    void Executable::ForEachChild(const ChildVisitor& /* visitor */) {
     }
 
     void ClassInstance::Print(std::ostream& os, Context& context) {
@@ -113,7 +419,38 @@ namespace runtime {
     }
 
     ClassInstance::ClassInstance(const Class& cls)
-        : cls_(cls) {
+        : Object(ObjectType::ClassInstance)
+        , cls_(cls) {
+    }
+
+    ClassInstance::~ClassInstance() {
+        if (gc_.collector != nullptr) {
+            gc_.collector->Untrack(*this);
+        }
+        ReleaseFields();
+    }
+
+    void ClassInstance::ReleaseFields() noexcept {
+        std::vector<ObjectHolder> pending;
+
+        // only the last references to instances go on, other fields are released in place
+        auto take_instances = [&pending](Closure& fields) {
+            for (auto& [name, value] : fields) {
+                if (value.IsUnique() && value.TryAs<ClassInstance>() != nullptr) {
+                    pending.push_back(std::move(value));
+                }
+            }
+        };
+
+        take_instances(fields_);
+
+        while (!pending.empty()) {
+            ObjectHolder field = std::move(pending.back());
+            pending.pop_back();
+
+            // the instance is destroyed here without the instances it held
+            take_instances(field.TryAs<ClassInstance>()->fields_);
+        }
     }
 
     ObjectHolder ClassInstance::Call(const std::string& method,
@@ -124,24 +461,84 @@ namespace runtime {
             throw std::runtime_error("No method found");
         }
 
-        auto* method_ptr = cls_.GetMethod(method);
+        return Call(*cls_.GetMethod(method), actual_args, context);
+    }
+
+    ObjectHolder ClassInstance::Call(const Method& method,
+                                     const std::vector<ObjectHolder>& actual_args,
+                                     Context& context) {
+        MemoCache* memo_cache = context.GetMemoCache();
+
+        if (memo_cache == nullptr || !method.pure) {
+            return Enter(method, actual_args, context);
+        }
+
+        auto key = MemoCache::MakeKey(method, cls_, actual_args);
+
+        if (!key) {
+            return Enter(method, actual_args, context);
+        }
+
+        if (const ObjectHolder* result = memo_cache->Find(*key)) {
+            return *result;
+        }
+
+        auto result = Enter(method, actual_args, context);
+        memo_cache->Insert(std::move(*key), result);
+
+        return result;
+    }
+
+    ObjectHolder ClassInstance::Enter(const Method& method,
+                                      const std::vector<ObjectHolder>& actual_args,
+                                      Context& context) {
+        if (MethodCompiler* compiler = context.GetMethodCompiler()) {
+            compiler->OnCall(method);
+        }
+
+        CallStack* call_stack = context.GetCallStack();
+
+        if (call_stack == nullptr) {
+            Closure cl;
+            return Invoke(method, cl, actual_args, context);
+        }
+
+        Closure& cl = call_stack->PushFrame(method);
 
-        Closure cl;
+        try {
+            auto result = Invoke(method, cl, actual_args, context);
+            call_stack->PopFrame();
+            return result;
+        } catch (...) {
+            call_stack->PopFrame();
+            throw;
+        }
+    }
 
+    ObjectHolder ClassInstance::Invoke(const Method& method, Closure& cl,
+                                       const std::vector<ObjectHolder>& actual_args, Context& context) {
         cl[SELF_OBJECT] = ObjectHolder::Share(*this);
 
-        size_t params_size = method_ptr->formal_params.size();
+        size_t params_size = method.formal_params.size();
 
         for (size_t i = 0; i < params_size; ++i) {
-            auto arg = method_ptr->formal_params[i];
-            cl[arg] = actual_args[i];
+            cl[method.formal_params[i]] = actual_args[i];
+        }
+
+        if (!method.body) {
+            throw std::runtime_error("method "s + method.name + " was removed as unreachable"s);
         }
 
-        return method_ptr->body->Execute(cl, context);
+        return method.body->Execute(cl, context);
+    }
+
+    const Class& ClassInstance::GetClass() const {
+        return cls_;
     }
 
     Class::Class(std::string name, std::vector<Method> methods, const Class* parent)
-        : name_(std::move(name))
+        : Object(ObjectType::Class)
+        , name_(std::move(name))
         , methods_(std::move(methods))
         , parent_(parent) {
 
@@ -171,6 +568,14 @@ namespace runtime {
         return nullptr;
     }
 
+    std::vector<Method>& Class::Methods() {
+        return methods_;
+    }
+
+    const std::vector<Method>& Class::Methods() const {
+        return methods_;
+    }
+
     const std::string& Class::GetName() const {
         return this->name_;
     }
@@ -184,34 +589,523 @@ namespace runtime {
         os << (GetValue() ? "True"sv : "False"sv);
     }
 
-    bool Equal(const ObjectHolder& lhs, const ObjectHolder& rhs, Context& context) {
-        if (!lhs && !rhs) {
-            return true;
+    BigNumber::BigNumber(bigint::BigInt value)
+        : Object(ObjectType::BigNumber)
+        , value_(std::move(value)) {
+    }
+
+    void BigNumber::Print(std::ostream& os, Context& /* context */) {
+        os << value_.ToString();
+    }
+
+    const bigint::BigInt& BigNumber::GetValue() const {
+        return value_;
+    }
+
+    namespace {
+        std::optional<bigint::BigInt> ToBigInt(const ObjectHolder& object) {
+            if (const auto* number = object.TryAs<Number>()) {
+                return bigint::BigInt(number->GetValue());
+            }
+            if (const auto* big_number = object.TryAs<BigNumber>()) {
+                return big_number->GetValue();
+            }
+            return nullopt;
         }
+    } // namespace
 
-        if (!lhs) {
-            throw std::runtime_error("Cannot compare objects for equality"s);
+    ObjectHolder ApplyBigArithmetic(ArithmeticOp op, const ObjectHolder& lhs, const ObjectHolder& rhs) {
+        auto lhs_value = ToBigInt(lhs);
+        auto rhs_value = ToBigInt(rhs);
+
+        if (!lhs_value || !rhs_value) {
+            return {};
         }
 
-        auto l_ptr_n = lhs.TryAs<runtime::Number>();
-        auto r_ptr_n = rhs.TryAs<runtime::Number>();
+        bigint::BigInt result;
+
+        switch (op) {
+        case ArithmeticOp::Add:
+            result = *lhs_value + *rhs_value;
+            break;
+        case ArithmeticOp::Sub:
+            result = *lhs_value - *rhs_value;
+            break;
+        case ArithmeticOp::Mult:
+            result = *lhs_value * *rhs_value;
+            break;
+        case ArithmeticOp::Div:
+            result = *lhs_value / *rhs_value;
+            break;
+        }
 
-        if (l_ptr_n != nullptr && r_ptr_n != nullptr) {
-            return l_ptr_n->GetValue() == r_ptr_n->GetValue();
+        if (auto small = result.ToInt64()) {
+            return ObjectHolder::Own(Number{ *small });
         }
 
-        auto l_ptr_s = lhs.TryAs<runtime::String>();
-        auto r_ptr_s = rhs.TryAs<runtime::String>();
+        return ObjectHolder::Own(BigNumber{ std::move(result) });
+    }
+
+    namespace {
+        // Native stack reserved for the code running between two method calls
+        // and for unwinding after StackOverflowError
+        constexpr size_t NATIVE_STACK_RESERVE = 256 * 1024;
+
+        struct NativeStackRun {
+            const std::function<void()>* function = nullptr;
+            std::exception_ptr error;
+            ucontext_t caller;
+            ucontext_t callee;
+        };
 
-        if (l_ptr_s != nullptr && r_ptr_s != nullptr) {
-            return l_ptr_s->GetValue() == r_ptr_s->GetValue();
+        thread_local NativeStackRun* current_run = nullptr;
+
+        void RunOnNativeStack() {
+            NativeStackRun* run = current_run;
+
+            try {
+                (*run->function)();
+            } catch (...) {
+                run->error = std::current_exception();
+            }
+            // returning resumes uc_link, that is the caller context
+        }
+    } // namespace
+
+    CallStack::CallStack(size_t memory_cap)
+        : memory_cap_(memory_cap) {
+        if (memory_cap_ <= NATIVE_STACK_RESERVE) {
+            throw std::invalid_argument("call stack memory cap is too small"s);
+        }
+    }
+
+    void CallStack::Run(const std::function<void()>& function) {
+        if (native_stack_top_ != nullptr) {
+            function();
+            return;
+        }
+
+        // Pages are committed on first touch, so the stack grows as deep as the program goes.
+        // An inaccessible page below the stack makes native recursion past it fault at once
+        // instead of writing into the neighbouring memory
+        const size_t guard_size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+        const size_t mapping_size = guard_size + memory_cap_;
+
+        void* mapping = mmap(nullptr, mapping_size, PROT_READ | PROT_WRITE,
+                             MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+        if (mapping == MAP_FAILED) {
+            throw std::runtime_error("cannot allocate interpreter stack"s);
+        }
+        if (mprotect(mapping, guard_size, PROT_NONE) != 0) {
+            munmap(mapping, mapping_size);
+            throw std::runtime_error("cannot protect interpreter stack"s);
+        }
+        void* stack = static_cast<char*>(mapping) + guard_size;
+
+        NativeStackRun run;
+        run.function = &function;
+
+        getcontext(&run.callee);
+        run.callee.uc_stack.ss_sp = stack;
+        run.callee.uc_stack.ss_size = memory_cap_;
+        run.callee.uc_link = &run.caller;
+        makecontext(&run.callee, RunOnNativeStack, 0);
+
+        NativeStackRun* outer_run = std::exchange(current_run, &run);
+        native_stack_top_ = static_cast<char*>(stack) + memory_cap_;
+
+        swapcontext(&run.caller, &run.callee);
+
+        current_run = outer_run;
+        native_stack_top_ = nullptr;
+        munmap(mapping, mapping_size);
+
+        if (run.error) {
+            std::rethrow_exception(run.error);
+        }
+    }
+
+    Closure& CallStack::PushFrame(const Method& method) {
+        size_t used = (depth_ + 1) * sizeof(Frame);
+
+        if (native_stack_top_ != nullptr) {
+            char marker;
+            used += static_cast<size_t>(native_stack_top_ - &marker);
+        }
+
+        if (used + NATIVE_STACK_RESERVE > memory_cap_) {
+            throw StackOverflowError("maximum recursion depth exceeded: "s + std::to_string(depth_)
+                                     + " frames, method "s + method.name);
+        }
+
+        if (depth_ == frames_.size()) {
+            frames_.emplace_back();
+        }
+
+        Frame& frame = frames_[depth_++];
+        frame.method = &method;
+
+        return frame.closure;
+    }
+
+    void CallStack::PopFrame() {
+        assert(depth_ > 0);
+
+        Frame& frame = frames_[--depth_];
+        frame.method = nullptr;
+        frame.closure.clear();
+    }
+
+    size_t CallStack::GetDepth() const {
+        return depth_;
+    }
+
+    size_t CallStack::GetMemoryCap() const {
+        return memory_cap_;
+    }
+
+    namespace {
+        std::optional<MemoCache::Value> ToMemoValue(const ObjectHolder& object) {
+            if (!object) {
+                return MemoCache::Value{};
+            }
+            if (const auto* number = object.TryAs<Number>()) {
+                return number->GetValue();
+            }
+            if (const auto* boolean = object.TryAs<Bool>()) {
+                return boolean->GetValue();
+            }
+            if (const auto* str = object.TryAs<String>()) {
+                return str->GetValue();
+            }
+            return nullopt;
+        }
+    } // namespace
+
+    bool MemoCache::Key::operator==(const Key& other) const {
+        return method == other.method && cls == other.cls && args == other.args;
+    }
+
+    size_t MemoCache::KeyHash::operator()(const Key& key) const {
+        size_t hash = std::hash<const void*>{}(key.method) * 37 + std::hash<const void*>{}(key.cls);
+
+        for (const auto& arg : key.args) {
+            hash = hash * 37 + std::hash<Value>{}(arg);
+        }
+
+        return hash;
+    }
+
+    MemoCache::MemoCache(size_t capacity)
+        : capacity_(capacity) {
+    }
+
+    std::optional<MemoCache::Key> MemoCache::MakeKey(const Method& method, const Class& cls,
+                                                     const std::vector<ObjectHolder>& args) {
+        Key key{ &method, &cls, {} };
+        key.args.reserve(args.size());
+
+        for (const auto& arg : args) {
+            auto value = ToMemoValue(arg);
+
+            if (!value) {
+                return nullopt;
+            }
+
+            key.args.push_back(std::move(*value));
+        }
+
+        return key;
+    }
+
+    const ObjectHolder* MemoCache::Find(const Key& key) {
+        auto it = entries_.find(key);
+
+        if (it == entries_.end()) {
+            ++misses_;
+            return nullptr;
+        }
+
+        ++hits_;
+        order_.splice(order_.begin(), order_, it->second.position);
+
+        return &it->second.result;
+    }
+
+    void MemoCache::Insert(Key key, const ObjectHolder& result) {
+        if (capacity_ == 0 || !ToMemoValue(result)) {
+            return;
+        }
+
+        if (auto it = entries_.find(key); it != entries_.end()) {
+            order_.splice(order_.begin(), order_, it->second.position);
+            it->second.result = result;
+            return;
+        }
+
+        if (entries_.size() == capacity_) {
+            entries_.erase(*order_.back());
+            order_.pop_back();
+        }
+
+        auto it = entries_.emplace(std::move(key), Entry{ result, {} }).first;
+        order_.push_front(&it->first);
+        it->second.position = order_.begin();
+    }
+
+    size_t MemoCache::GetHits() const {
+        return hits_;
+    }
+
+    size_t MemoCache::GetMisses() const {
+        return misses_;
+    }
+
+    size_t MemoCache::GetSize() const {
+        return entries_.size();
+    }
+
+    size_t MemoCache::GetCapacity() const {
+        return capacity_;
+    }
+
+    namespace {
+        thread_local GarbageCollector* current_collector = nullptr;
+
+        // outside_refs of an instance found alive by a collection
+        constexpr std::int32_t ALIVE = INT32_MIN;
+    } // namespace
+
+    void TrackInstance(ClassInstance& instance) {
+        if (current_collector != nullptr) {
+            current_collector->Track(instance);
+        }
+    }
+
+    GarbageCollector::GarbageCollector()
+        : GarbageCollector(Config{}) {
+    }
+
+    GarbageCollector::GarbageCollector(Config config)
+        : config_(config)
+        , previous_(std::exchange(current_collector, this)) {
+    }
+
+    GarbageCollector::~GarbageCollector() {
+        Collect(true);
+        Abandon();
+
+        current_collector = previous_;
+    }
+
+    void GarbageCollector::Abandon() {
+        for (auto& generation : generations_) {
+            while (generation.head != nullptr) {
+                Untrack(*generation.head);
+            }
+        }
+    }
+
+    size_t GarbageCollector::Collect(bool full) {
+        if (collecting_) {
+            return 0;
+        }
+        collecting_ = true;
+
+        const auto start = std::chrono::steady_clock::now();
+        const std::uint8_t oldest = full ? OLD : NURSERY;
+
+        auto for_each_collected = [&](auto visit) {
+            for (std::uint8_t generation = NURSERY; generation <= oldest; ++generation) {
+                for (ClassInstance* instance = generations_[generation].head; instance != nullptr;) {
+                    // the visit may unlink the instance
+                    ClassInstance* next = instance->gc_.next;
+                    visit(*instance);
+                    instance = next;
+                }
+            }
+        };
+
+        auto for_each_referenced = [&](const ClassInstance& instance, auto visit) {
+            for (const auto& name_value : instance.fields_) {
+                auto* field = name_value.second.TryAs<ClassInstance>();
+                if (IsCollected(field, oldest)) {
+                    visit(*field);
+                }
+            }
+        };
+
+        // references left after the subtraction come from outside
+        for_each_collected([](ClassInstance& instance) {
+            instance.gc_.outside_refs = static_cast<std::int32_t>(instance.Load() >> Object::COUNT_SHIFT);
+        });
+        for_each_collected([&](ClassInstance& instance) {
+            for_each_referenced(instance, [](ClassInstance& field) {
+                --field.gc_.outside_refs;
+            });
+        });
+
+        std::vector<ClassInstance*> alive;
+        for_each_collected([&](ClassInstance& instance) {
+            if (instance.gc_.outside_refs != 0) {
+                instance.gc_.outside_refs = ALIVE;
+                alive.push_back(&instance);
+            }
+        });
+        while (!alive.empty()) {
+            ClassInstance* instance = alive.back();
+            alive.pop_back();
+
+            for_each_referenced(*instance, [&](ClassInstance& field) {
+                if (field.gc_.outside_refs != ALIVE) {
+                    field.gc_.outside_refs = ALIVE;
+                    alive.push_back(&field);
+                }
+            });
+        }
+
+        // the holders keep the garbage until all of it is cleared
+        std::vector<ObjectHolder> garbage;
+        for_each_collected([&](ClassInstance& instance) {
+            if (instance.gc_.outside_refs != ALIVE) {
+                Untrack(instance);
+                garbage.push_back(ObjectHolder::Share(instance));
+            }
+        });
+
+        if (full) {
+            collections_since_full_ = 0;
+            promoted_since_full_ = 0;
+            ++stats_.full_collections;
+        } else {
+            ++collections_since_full_;
+            promoted_since_full_ += generations_[NURSERY].size;
+            while (generations_[NURSERY].head != nullptr) {
+                ClassInstance& instance = *generations_[NURSERY].head;
+                Untrack(instance);
+                Link(instance, OLD);
+            }
+        }
+
+        for (auto& holder : garbage) {
+            // the values are released when the fields go out of scope
+            Closure fields;
+            fields.swap(holder.TryAs<ClassInstance>()->fields_);
+        }
+        const size_t freed = garbage.size();
+        garbage.clear();
+
+        const auto pause = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start);
+        ++stats_.collections;
+        stats_.freed += freed;
+        stats_.total_pause += pause;
+        stats_.max_pause = std::max(stats_.max_pause, pause);
+
+        collecting_ = false;
+        return freed;
+    }
+
+    const GarbageCollector::Config& GarbageCollector::GetConfig() const {
+        return config_;
+    }
+
+    const GarbageCollector::Stats& GarbageCollector::GetStats() const {
+        return stats_;
+    }
+
+    size_t GarbageCollector::GetTracked() const {
+        return generations_[NURSERY].size + generations_[OLD].size;
+    }
+
+    void GarbageCollector::Track(ClassInstance& instance) {
+        if (config_.stress || ++allocations_ > config_.nursery_threshold) {
+            allocations_ = 0;
+
+            // a full collection costs as much as the old generation,
+            // it waits until a quarter of the generation is new
+            const size_t old_size = generations_[OLD].size;
+            const bool full = collections_since_full_ + 1 >= config_.full_collection_period
+                              && promoted_since_full_ * 4 >= old_size - std::min(old_size, promoted_since_full_);
+
+            Collect(full);
+        }
+
+        Link(instance, NURSERY);
+    }
+
+    void GarbageCollector::Untrack(ClassInstance& instance) {
+        auto& links = instance.gc_;
+        Generation& generation = generations_[links.generation];
+
+        if (links.prev != nullptr) {
+            links.prev->gc_.next = links.next;
+        } else {
+            generation.head = links.next;
+        }
+        if (links.next != nullptr) {
+            links.next->gc_.prev = links.prev;
+        }
+
+        --generation.size;
+        links.collector = nullptr;
+        links.prev = nullptr;
+        links.next = nullptr;
+    }
+
+    void GarbageCollector::Link(ClassInstance& instance, std::uint8_t generation) {
+        auto& links = instance.gc_;
+        Generation& list = generations_[generation];
+
+        links.collector = this;
+        links.generation = generation;
+        links.prev = nullptr;
+        links.next = list.head;
+        if (list.head != nullptr) {
+            list.head->gc_.prev = &instance;
+        }
+        list.head = &instance;
+        ++list.size;
+    }
+
+    bool GarbageCollector::IsCollected(const ClassInstance* instance, std::uint8_t oldest) const {
+        return instance != nullptr && instance->gc_.collector == this && instance->gc_.generation <= oldest;
+    }
+
+    namespace {
+        // Both objects have the type tag of T
+        template <typename T, typename Compare>
+        bool CompareValues(const ObjectHolder& lhs, const ObjectHolder& rhs, Compare compare) {
+            return compare(static_cast<const T&>(*lhs).GetValue(), static_cast<const T&>(*rhs).GetValue());
+        }
+    } // namespace
+
+    bool Equal(const ObjectHolder& lhs, const ObjectHolder& rhs, Context& context) {
+        if (!lhs && !rhs) {
+            return true;
+        }
+
+        if (!lhs) {
+            throw std::runtime_error("Cannot compare objects for equality"s);
         }
 
-        auto l_ptr_b = lhs.TryAs<runtime::Bool>();
-        auto r_ptr_b = rhs.TryAs<runtime::Bool>();
+        if (rhs && lhs->GetType() == rhs->GetType()) {
+            switch (lhs->GetType()) {
+            case ObjectType::Number:
+                return CompareValues<Number>(lhs, rhs, std::equal_to<>());
+            case ObjectType::BigNumber:
+                return CompareValues<BigNumber>(lhs, rhs, std::equal_to<>());
+            case ObjectType::String:
+                return *lhs.TryAs<String>() == *rhs.TryAs<String>();
+            case ObjectType::Bool:
+                return CompareValues<Bool>(lhs, rhs, std::equal_to<>());
+            default:
+                break;
+            }
+        }
 
-        if (l_ptr_b != nullptr && r_ptr_b != nullptr) {
-            return l_ptr_b->GetValue() == r_ptr_b->GetValue();
+        // a BigNumber is out of the range of Number
+        if (auto lhs_value = ToBigInt(lhs), rhs_value = ToBigInt(rhs); lhs_value && rhs_value) {
+            return false;
         }
 
         auto l_ptr_class_inst = lhs.TryAs<runtime::ClassInstance>();
@@ -231,25 +1125,23 @@ namespace runtime {
             throw std::runtime_error("Cannot compare objects for equality"s);
         }
 
-        auto l_ptr_n = lhs.TryAs<runtime::Number>();
-        auto r_ptr_n = rhs.TryAs<runtime::Number>();
-
-        if (l_ptr_n != nullptr && r_ptr_n != nullptr) {
-            return l_ptr_n->GetValue() < r_ptr_n->GetValue();
-        }
-
-        auto l_ptr_s = lhs.TryAs<runtime::String>();
-        auto r_ptr_s = rhs.TryAs<runtime::String>();
-
-        if (l_ptr_s != nullptr && r_ptr_s != nullptr) {
-            return l_ptr_s->GetValue() < r_ptr_s->GetValue();
+        if (rhs && lhs->GetType() == rhs->GetType()) {
+            switch (lhs->GetType()) {
+            case ObjectType::Number:
+                return CompareValues<Number>(lhs, rhs, std::less<>());
+            case ObjectType::BigNumber:
+                return CompareValues<BigNumber>(lhs, rhs, std::less<>());
+            case ObjectType::String:
+                return CompareValues<String>(lhs, rhs, std::less<>());
+            case ObjectType::Bool:
+                return CompareValues<Bool>(lhs, rhs, std::less<>());
+            default:
+                break;
+            }
         }
 
-        auto l_ptr_b = lhs.TryAs<runtime::Bool>();
-        auto r_ptr_b = rhs.TryAs<runtime::Bool>();
-
-        if (l_ptr_b != nullptr && r_ptr_b != nullptr) {
-            return l_ptr_b->GetValue() < r_ptr_b->GetValue();
+        if (auto lhs_value = ToBigInt(lhs), rhs_value = ToBigInt(rhs); lhs_value && rhs_value) {
+            return *lhs_value < *rhs_value;
         }
 
         auto l_ptr_class_inst = lhs.TryAs<runtime::ClassInstance>();
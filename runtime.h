@@ -1,36 +1,452 @@
 #pragma once
 
+#include "bigint.h"
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <list>
 #include <memory>
+#include <new>
+#include <optional>
 #include <sstream>
+#include <stdexcept>
 #include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
 #include <unordered_map>
+#include <variant>
 #include <vector>
 
 namespace runtime {
 
+    // Pending break/continue of the innermost loop
+    enum class LoopSignal {
+        None,
+        Break,
+        Continue,
+    };
+
+    class CallStack;
+    class Class;
+    class ClassInstance;
+    class GarbageCollector;
+    class MemoCache;
+    class MethodCompiler;
+
     class Context {
     public:
         virtual std::ostream& GetOutputStream() = 0;
 
+        // Method calls keep their frames in the call stack if it's set,
+        // otherwise a call without limits is made on the native stack
+        CallStack* GetCallStack() const {
+            return call_stack_;
+        }
+
+        void SetCallStack(CallStack* call_stack) {
+            call_stack_ = call_stack;
+        }
+
+        // Calls of pure methods with value arguments go through the cache if it's set
+        MemoCache* GetMemoCache() const {
+            return memo_cache_;
+        }
+
+        void SetMemoCache(MemoCache* memo_cache) {
+            memo_cache_ = memo_cache;
+        }
+
+        MethodCompiler* GetMethodCompiler() const {
+            return method_compiler_;
+        }
+
+        void SetMethodCompiler(MethodCompiler* method_compiler) {
+            method_compiler_ = method_compiler;
+        }
+
+        LoopSignal GetLoopSignal() const {
+            return loop_signal_;
+        }
+
+        void SetLoopSignal(LoopSignal signal) {
+            loop_signal_ = signal;
+        }
+
     protected:
         ~Context() = default;
+
+    private:
+        LoopSignal loop_signal_ = LoopSignal::None;
+        CallStack* call_stack_ = nullptr;
+        MemoCache* memo_cache_ = nullptr;
+        MethodCompiler* method_compiler_ = nullptr;
+    };
+
+    // Tag of the built-in object types, ObjectHolder::TryAs compares it instead of a dynamic_cast.
+    // Objects of other types are Other and are cast dynamically
+    enum class ObjectType : unsigned char {
+        Other,
+        Number,
+        String,
+        Bool,
+        Class,
+        ClassInstance,
+        BigNumber,
     };
 
+#ifdef MYTHON_ATOMIC_REFCOUNT
+    inline constexpr bool ATOMIC_REFCOUNT = true;
+#else
+    // An interpreter runs on one thread, so reference counts are plain integers by default
+    inline constexpr bool ATOMIC_REFCOUNT = false;
+#endif
+
+    // The object header is one word after the vtable pointer: the type tag in the low byte and
+    // the reference count above it. Objects made by ObjectHolder::Own start with one reference.
+    // Any other object (a local, a member, a copy) is borrowed: its count is BORROWED, holders
+    // don't change it and never free the object. A count that reaches BORROWED sticks there,
+    // so an object referenced that many times lives to the end of the program
     class Object {
     public:
         virtual ~Object() = default;
         virtual void Print(std::ostream& os, Context& context) = 0;
+
+        ObjectType GetType() const {
+            return static_cast<ObjectType>(Load() & TYPE_MASK);
+        }
+
+        bool IsBorrowed() const {
+            return (Load() >> COUNT_SHIFT) == BORROWED;
+        }
+
+        // Objects created with new come from size-class free lists of the current thread,
+        // so the churn of instances and strings doesn't go to the global allocator
+        static void* operator new(std::size_t size);
+        static void operator delete(void* object, std::size_t size) noexcept;
+
+        static void* operator new(std::size_t /* size */, void* place) noexcept {
+            return place;
+        }
+
+    protected:
+        explicit Object(ObjectType type = ObjectType::Other)
+            : header_(MakeHeader(type, BORROWED)) {
+        }
+
+        // a copy is a new object, the reference count isn't copied
+        Object(const Object& other)
+            : header_(MakeHeader(other.GetType(), BORROWED)) {
+        }
+
+        Object& operator=(const Object& /* other */) {
+            return *this;
+        }
+
+    private:
+        friend class GarbageCollector;
+        friend class ObjectHolder;
+
+        static constexpr std::uint32_t COUNT_SHIFT = 8;
+        static constexpr std::uint32_t TYPE_MASK = (1U << COUNT_SHIFT) - 1;
+        static constexpr std::uint32_t ONE_REFERENCE = 1U << COUNT_SHIFT;
+        static constexpr std::uint32_t BORROWED = ~std::uint32_t{ 0 } >> COUNT_SHIFT;
+
+        static constexpr std::uint32_t MakeHeader(ObjectType type, std::uint32_t count) {
+            return static_cast<std::uint32_t>(type) | count << COUNT_SHIFT;
+        }
+
+        std::uint32_t Load() const noexcept {
+            if constexpr (ATOMIC_REFCOUNT) {
+                return __atomic_load_n(&header_, __ATOMIC_RELAXED);
+            } else {
+                return header_;
+            }
+        }
+
+        void Adopt() noexcept {
+            header_ = MakeHeader(GetType(), 1);
+        }
+
+        void Retain() noexcept {
+            if (IsBorrowed()) {
+                return;
+            }
+            if constexpr (ATOMIC_REFCOUNT) {
+                __atomic_add_fetch(&header_, ONE_REFERENCE, __ATOMIC_RELAXED);
+            } else {
+                header_ += ONE_REFERENCE;
+            }
+        }
+
+        // true if the last reference is gone
+        bool Release() noexcept {
+            if (IsBorrowed()) {
+                return false;
+            }
+            if constexpr (ATOMIC_REFCOUNT) {
+                return (__atomic_sub_fetch(&header_, ONE_REFERENCE, __ATOMIC_ACQ_REL) >> COUNT_SHIFT) == 0;
+            } else {
+                header_ -= ONE_REFERENCE;
+                return (header_ >> COUNT_SHIFT) == 0;
+            }
+        }
+
+        std::uint32_t header_;
+    };
+
+    template <typename T>
+    class ValueObject : public Object {
+    public:
+        ValueObject(T v)
+            : Object(TYPE)
+            , value_(v) {
+        }
+
+        void Print(std::ostream& os, [[maybe_unused]] Context& context) override {
+            os << value_;
+        }
+
+        const T& GetValue() const {
+            return value_;
+        }
+
+    protected:
+        ValueObject(T v, ObjectType type)
+            : Object(type)
+            , value_(v) {
+        }
+
+    private:
+        // ValueObject<bool> itself is not a Bool
+        static constexpr ObjectType TYPE = std::is_same_v<T, std::int64_t> ? ObjectType::Number : ObjectType::Other;
+
+        T value_;
+    };
+
+    using Number = ValueObject<std::int64_t>;
+
+    // Integer out of the range of Number. Integer arithmetic promotes to it on overflow (see
+    // ApplyBigArithmetic) and gives a Number again as soon as the result fits
+    class BigNumber : public Object {
+    public:
+        explicit BigNumber(bigint::BigInt value);
+
+        void Print(std::ostream& os, Context& context) override;
+
+        const bigint::BigInt& GetValue() const;
+
+    private:
+        bigint::BigInt value_;
+    };
+
+    class ObjectHolder;
+
+    // A string is either flat or a rope: the concatenation of two strings, which are referenced
+    // until the value is needed. GetValue and Print flatten a rope in place and drop the
+    // references, GetSize doesn't. Building a string piece by piece with Concat is linear then
+    class String : public Object {
+    public:
+        // shorter concatenations are copied right away
+        static constexpr size_t ROPE_THRESHOLD = 256;
+
+        String(std::string value);
+
+        // a copy is always flat
+        String(const String& other);
+        String(String&& other) noexcept;
+        String& operator=(String other) noexcept;
+
+        ~String() override;
+
+        // Both holders must contain strings. Strings not made by ObjectHolder::Own may change or
+        // go away, the rope keeps a copy of them
+        static ObjectHolder Concat(const ObjectHolder& lhs, const ObjectHolder& rhs);
+
+        // The interned string of the value: there is one per value and thread while it is
+        // referenced, so interned strings are equal only if they are the same object. The table
+        // of interned strings doesn't reference them, a string leaves it when destroyed
+        static ObjectHolder Intern(std::string value);
+
+        bool IsInterned() const {
+            return interned_;
+        }
+
+        // computed once, flattens a rope
+        size_t GetHash() const;
+
+        void Print(std::ostream& os, Context& context) override;
+
+        const std::string& GetValue() const {
+            if (rope_) {
+                Flatten();
+            }
+            return value_;
+        }
+
+        size_t GetSize() const {
+            return size_;
+        }
+
+        bool IsRope() const {
+            return rope_ != nullptr;
+        }
+
+    private:
+        struct Rope;
+
+        void Flatten() const;
+        // without recursion, a rope built by a loop is as deep as the number of iterations
+        void ReleaseRope() const noexcept;
+
+        mutable std::string value_;
+        mutable std::unique_ptr<Rope> rope_;
+        size_t size_;
+        mutable size_t hash_ = 0;
+        mutable bool has_hash_ = false;
+        bool interned_ = false;
     };
 
+    // Addresses of interned strings are compared first, sizes before the values
+    bool operator==(const String& lhs, const String& rhs);
+
+    inline bool operator!=(const String& lhs, const String& rhs) {
+        return !(lhs == rhs);
+    }
+
+    inline bool operator<(const String& lhs, const String& rhs) {
+        return lhs.GetValue() < rhs.GetValue();
+    }
+
+    inline bool operator>(const String& lhs, const String& rhs) {
+        return rhs < lhs;
+    }
+
+    inline bool operator<=(const String& lhs, const String& rhs) {
+        return !(rhs < lhs);
+    }
+
+    inline bool operator>=(const String& lhs, const String& rhs) {
+        return !(lhs < rhs);
+    }
+
+    class Bool : public ValueObject<bool> {
+    public:
+        Bool(bool v)
+            : ValueObject<bool>(v, ObjectType::Bool) {
+        }
+
+        void Print(std::ostream& os, Context& context) override;
+    };
+
+    // Tag of the objects of type T, Other if T isn't a tagged type
+    template <typename T>
+    struct ObjectTypeOf {
+        static constexpr ObjectType value = ObjectType::Other;
+    };
+
+    template <>
+    struct ObjectTypeOf<Number> {
+        static constexpr ObjectType value = ObjectType::Number;
+    };
+
+    template <>
+    struct ObjectTypeOf<String> {
+        static constexpr ObjectType value = ObjectType::String;
+    };
+
+    template <>
+    struct ObjectTypeOf<Bool> {
+        static constexpr ObjectType value = ObjectType::Bool;
+    };
+
+    template <>
+    struct ObjectTypeOf<Class> {
+        static constexpr ObjectType value = ObjectType::Class;
+    };
+
+    template <>
+    struct ObjectTypeOf<ClassInstance> {
+        static constexpr ObjectType value = ObjectType::ClassInstance;
+    };
+
+    template <>
+    struct ObjectTypeOf<BigNumber> {
+        static constexpr ObjectType value = ObjectType::BigNumber;
+    };
+
+    // Hands an instance made by Own to the garbage collector of the thread, if there is one
+    void TrackInstance(ClassInstance& instance);
+
+    // Numbers and bools made by Own are immediates: the value object lives in the holder itself,
+    // with no heap allocation and no reference count. Get, TryAs and the operators point into the
+    // holder then, such a pointer is valid while the holder lives and isn't assigned.
+    // Objects made by Own are referenced by a pointer counted in the object header (see Object),
+    // other objects by a borrowed pointer.
+    // The holder is four words on 64-bit targets rather than one: an immediate is a whole Number
+    // or Bool, with its vtable pointer and header, so that a pointer to it can be handed out like
+    // a pointer to any object. The larger holder is the price of numbers and bools that never
+    // touch the heap or a reference count
     class ObjectHolder {
     public:
-        ObjectHolder() = default;
+        ObjectHolder() noexcept
+            : data_(nullptr) {
+        }
+
+        ObjectHolder(const ObjectHolder& other) noexcept {
+            CopyFrom(other);
+        }
+
+        ObjectHolder(ObjectHolder&& other) noexcept {
+            MoveFrom(std::move(other));
+        }
+
+        // the source may be owned by the object this holder releases, so it's released after
+        // the source is taken
+        ObjectHolder& operator=(const ObjectHolder& other) noexcept {
+            if (this != &other) {
+                ObjectHolder released(std::move(*this));
+                CopyFrom(other);
+            }
+            return *this;
+        }
+
+        ObjectHolder& operator=(ObjectHolder&& other) noexcept {
+            if (this != &other) {
+                ObjectHolder released(std::move(*this));
+                MoveFrom(std::move(other));
+            }
+            return *this;
+        }
+
+        ~ObjectHolder() {
+            Destroy();
+        }
 
         template <typename T>
         static ObjectHolder Own(T&& object) {
-            return ObjectHolder(std::make_shared<T>(std::forward<T>(object)));
+            using Value = std::decay_t<T>;
+
+            if constexpr (std::is_same_v<Value, Number>) {
+                return ObjectHolder(Number{ object.GetValue() });
+            } else if constexpr (std::is_same_v<Value, Bool>) {
+                return ObjectHolder(Bool{ object.GetValue() });
+            } else {
+                Object* data = new Value(std::forward<T>(object));
+                data->Adopt();
+                if constexpr (std::is_same_v<Value, ClassInstance>) {
+                    TrackInstance(static_cast<Value&>(*data));
+                }
+                return ObjectHolder(data, Kind::Counted);
+            }
         }
 
+        // A borrowed object isn't counted and must outlive the holder. Sharing an object made by
+        // Own adds a reference
         static ObjectHolder Share(Object& object);
         static ObjectHolder None();
 
@@ -38,39 +454,136 @@ namespace runtime {
 
         Object* operator->() const;
 
-        Object* Get() const;
+        Object* Get() const {
+            switch (kind_) {
+            case Kind::Number:
+                return const_cast<Number*>(&number_);
+            case Kind::Bool:
+                return const_cast<Bool*>(&bool_);
+            default:
+                return data_;
+            }
+        }
 
+        // Tagged types are checked by the object tag (immediates by the holder kind) and cast
+        // statically, others with a dynamic_cast
         template <typename T>
         [[nodiscard]] T* TryAs() const {
-            return dynamic_cast<T*>(this->Get());
+            constexpr ObjectType type = ObjectTypeOf<T>::value;
+
+            if constexpr (type == ObjectType::Number) {
+                return kind_ == Kind::Number ? const_cast<Number*>(&number_) : TryAsPointer<T>(type);
+            } else if constexpr (type == ObjectType::Bool) {
+                return kind_ == Kind::Bool ? const_cast<Bool*>(&bool_) : TryAsPointer<T>(type);
+            } else if constexpr (type != ObjectType::Other) {
+                return TryAsPointer<T>(type);
+            } else {
+                return dynamic_cast<T*>(Get());
+            }
+        }
+
+        explicit operator bool() const {
+            return !IsPointer() || data_ != nullptr;
         }
 
-        explicit operator bool() const;
+        // true if this is the only reference to an object made by Own
+        bool IsUnique() const {
+            return kind_ == Kind::Counted && (data_->Load() >> Object::COUNT_SHIFT) == 1;
+        }
 
     private:
-        explicit ObjectHolder(std::shared_ptr<Object> data);
+        // A borrowed pointer (null included) is never dereferenced by the holder itself,
+        // the object may go away before the holder does as long as it isn't used
+        enum class Kind : unsigned char {
+            Counted,
+            Borrowed,
+            Number,
+            Bool,
+        };
+
+        // a counted holder takes over a reference to the object
+        ObjectHolder(Object* data, Kind kind) noexcept
+            : data_(data)
+            , kind_(kind) {
+        }
+
+        bool IsPointer() const {
+            return kind_ == Kind::Counted || kind_ == Kind::Borrowed;
+        }
+
+        explicit ObjectHolder(Number number) noexcept
+            : number_(number)
+            , kind_(Kind::Number) {
+        }
+
+        explicit ObjectHolder(Bool boolean) noexcept
+            : bool_(boolean)
+            , kind_(Kind::Bool) {
+        }
+
         void AssertIsValid() const;
 
-        std::shared_ptr<Object> data_;
-    };
+        template <typename T>
+        T* TryAsPointer(ObjectType type) const {
+            if (!IsPointer() || data_ == nullptr || data_->GetType() != type) {
+                return nullptr;
+            }
+            return static_cast<T*>(data_);
+        }
 
-    template <typename T>
-    class ValueObject : public Object {
-    public:
-        ValueObject(T v)
-            : value_(v) {
+        // The storage must be empty or hold an immediate, which owns nothing. An immediate is made
+        // again from its value, only the member of the source's kind is read
+        void CopyFrom(const ObjectHolder& other) noexcept {
+            switch (other.kind_) {
+            case Kind::Number:
+                new (&number_) Number(other.number_.GetValue());
+                break;
+            case Kind::Bool:
+                new (&bool_) Bool(other.bool_.GetValue());
+                break;
+            case Kind::Counted:
+                other.data_->Retain();
+                [[fallthrough]];
+            default:
+                data_ = other.data_;
+            }
+            kind_ = other.kind_;
         }
 
-        void Print(std::ostream& os, [[maybe_unused]] Context& context) override {
-            os << value_;
+        // As CopyFrom, a moved pointer leaves the source empty, a moved immediate stays in it
+        void MoveFrom(ObjectHolder&& other) noexcept {
+            if (other.IsPointer()) {
+                data_ = std::exchange(other.data_, nullptr);
+                kind_ = std::exchange(other.kind_, Kind::Borrowed);
+            } else {
+                CopyFrom(other);
+            }
         }
 
-        const T& GetValue() const {
-            return value_;
+        void Destroy() noexcept {
+            switch (kind_) {
+            case Kind::Number:
+                number_.~Number();
+                break;
+            case Kind::Bool:
+                bool_.~Bool();
+                break;
+            case Kind::Counted:
+                if (data_->Release()) {
+                    delete data_;
+                }
+                break;
+            default:
+                break;
+            }
         }
 
-    private:
-        T value_;
+        union {
+            Object* data_;
+            Number number_;
+            Bool bool_;
+        };
+        Kind kind_ = Kind::Borrowed;
     };
 
     using Closure = std::unordered_map<std::string, ObjectHolder>;
@@ -79,24 +592,53 @@ namespace runtime {
 
     class Executable {
     public:
+        using ChildVisitor = std::function<void(std::unique_ptr<Executable>&)>;
+
         virtual ~Executable() = default;
         virtual ObjectHolder Execute(Closure& closure, Context& context) = 0;
-    };
 
-    using String = ValueObject<std::string>;
-    using Number = ValueObject<int>;
+        // Executes the statement as a condition. Logical operations and comparisons
+        // override it to return the result without allocating a Bool object
+        virtual bool ExecuteCondition(Closure& closure, Context& context);
 
-    class Bool : public ValueObject<bool> {
-    public:
-        using ValueObject<bool>::ValueObject;
-
-        void Print(std::ostream& os, Context& context) override;
+        // Calls visitor for every nested statement, so that optimization passes
+        // can inspect and replace them. Leaf statements have nothing to visit
+        virtual void ForEachChild(const ChildVisitor& visitor);
     };
 
+
     struct Method {
         std::string name;
         std::vector<std::string> formal_params;
         std::unique_ptr<Executable> body;
+        // Set by the optimizer (see optimize::MarkPureMethods): the result depends only on the class
+        // of self and the argument values, and the call has no other effect
+        bool pure = false;
+        // Calls counted by the method compiler of the context
+        mutable size_t calls = 0;
+    };
+
+    // Compiles methods once they have been called hot_calls times through ClassInstance::Call,
+    // see jit::Jit
+    class MethodCompiler {
+    public:
+        explicit MethodCompiler(size_t hot_calls)
+            : hot_calls_(hot_calls) {
+        }
+
+        void OnCall(const Method& method) {
+            if (++method.calls == hot_calls_) {
+                Compile(method);
+            }
+        }
+
+    protected:
+        ~MethodCompiler() = default;
+
+        virtual void Compile(const Method& method) = 0;
+
+    private:
+        size_t hot_calls_;
     };
 
     class Class : public Object {
@@ -105,6 +647,10 @@ namespace runtime {
 
         const Method* GetMethod(const std::string& name) const;
 
+        std::vector<Method>& Methods();
+
+        const std::vector<Method>& Methods() const;
+
         const std::string& GetName() const;
 
         void Print(std::ostream& os, Context& context) override;
@@ -123,20 +669,280 @@ namespace runtime {
     public:
         explicit ClassInstance(const Class& cls);
 
+        ClassInstance(const ClassInstance&) = default;
+        ClassInstance(ClassInstance&&) = default;
+
+        ~ClassInstance() override;
+
         void Print(std::ostream& os, Context& context) override;
 
         ObjectHolder Call(const std::string& method, const std::vector<ObjectHolder>& actual_args,
                           Context& context);
 
+        // Calls an already resolved method of the instance class, arguments count must match
+        ObjectHolder Call(const Method& method, const std::vector<ObjectHolder>& actual_args,
+                          Context& context);
+
         bool HasMethod(const std::string& method, size_t argument_count) const;
 
+        const Class& GetClass() const;
+
         Closure& Fields();
 
         const Closure& Fields() const;
 
     private:
+        // Releases the fields without recursion, a long chain of instances is released in a loop
+        void ReleaseFields() noexcept;
+
+        ObjectHolder Enter(const Method& method, const std::vector<ObjectHolder>& actual_args, Context& context);
+        ObjectHolder Invoke(const Method& method, Closure& cl, const std::vector<ObjectHolder>& actual_args,
+                            Context& context);
+
+        friend class GarbageCollector;
+
+        // Place of a tracked instance in a generation of its collector. A copy isn't tracked
+        struct GcLinks {
+            GcLinks() = default;
+
+            GcLinks(const GcLinks& /* other */) noexcept {
+            }
+
+            GcLinks& operator=(const GcLinks& /* other */) noexcept {
+                return *this;
+            }
+
+            GarbageCollector* collector = nullptr;
+            ClassInstance* prev = nullptr;
+            ClassInstance* next = nullptr;
+            // references from outside of the collected instances, valid during a collection
+            std::int32_t outside_refs = 0;
+            std::uint8_t generation = 0;
+        };
+
         const Class& cls_;
         Closure fields_;
+        GcLinks gc_;
+    };
+
+    class StackOverflowError : public std::runtime_error {
+    public:
+        using std::runtime_error::runtime_error;
+    };
+
+    // Mython call stack. Frame records with the method closures live in the heap and are reused
+    // by later calls. Run executes the interpreter on a native stack of memory_cap bytes, and every
+    // call checks the used memory against the cap, so deep recursion fails with
+    // StackOverflowError instead of crashing the process
+    class CallStack {
+    public:
+        static constexpr size_t DEFAULT_MEMORY_CAP = 256 * 1024 * 1024;
+
+        explicit CallStack(size_t memory_cap = DEFAULT_MEMORY_CAP);
+
+        CallStack(const CallStack&) = delete;
+        CallStack& operator=(const CallStack&) = delete;
+
+        void Run(const std::function<void()>& function);
+
+        // Returns an empty closure for the method call, throws StackOverflowError if the cap is exceeded
+        Closure& PushFrame(const Method& method);
+        void PopFrame();
+
+        size_t GetDepth() const;
+        size_t GetMemoryCap() const;
+
+    private:
+        struct Frame {
+            const Method* method = nullptr;
+            Closure closure;
+        };
+
+        // deque keeps frames in place while it grows, closures are referenced by running calls
+        std::deque<Frame> frames_;
+        size_t depth_ = 0;
+        size_t memory_cap_;
+
+        // Native stack allocated by Run, null outside of it
+        char* native_stack_top_ = nullptr;
+    };
+
+    // Results of pure method calls (see Method::pure) keyed by the method, the class of self and
+    // the argument values. At most capacity results are kept, the least recently used one is
+    // evicted first
+    class MemoCache {
+    public:
+        static constexpr size_t DEFAULT_CAPACITY = 64 * 1024;
+
+        // None, number, bool or string
+        using Value = std::variant<std::monostate, std::int64_t, bool, std::string>;
+
+        struct Key {
+            const Method* method = nullptr;
+            const Class* cls = nullptr;
+            std::vector<Value> args;
+
+            bool operator==(const Key& other) const;
+        };
+
+        explicit MemoCache(size_t capacity = DEFAULT_CAPACITY);
+
+        MemoCache(const MemoCache&) = delete;
+        MemoCache& operator=(const MemoCache&) = delete;
+
+        // Returns nullopt if an argument is not a value: instances may change between calls
+        static std::optional<Key> MakeKey(const Method& method, const Class& cls,
+                                          const std::vector<ObjectHolder>& args);
+
+        // Returns null if there is no result for the key
+        const ObjectHolder* Find(const Key& key);
+        // Results that are not values aren't kept
+        void Insert(Key key, const ObjectHolder& result);
+
+        size_t GetHits() const;
+        size_t GetMisses() const;
+        size_t GetSize() const;
+        size_t GetCapacity() const;
+
+    private:
+        struct KeyHash {
+            size_t operator()(const Key& key) const;
+        };
+
+        struct Entry {
+            ObjectHolder result;
+            std::list<const Key*>::iterator position;
+        };
+
+        std::unordered_map<Key, Entry, KeyHash> entries_;
+        // keys of entries_, the most recently used first
+        std::list<const Key*> order_;
+        size_t capacity_;
+        size_t hits_ = 0;
+        size_t misses_ = 0;
+    };
+
+    enum class ArithmeticOp {
+        Add,
+        Sub,
+        Mult,
+        Div,
+    };
+
+    // Slow path of integer arithmetic, taken when a Number operation overflows or an operand is
+    // a BigNumber. The result is a Number if it fits. Returns an empty holder if an operand isn't
+    // an integer, throws std::runtime_error on division by zero
+    ObjectHolder ApplyBigArithmetic(ArithmeticOp op, const ObjectHolder& lhs, const ObjectHolder& rhs);
+
+    // Memory of the objects made during one run of a program. While a region is alive, objects
+    // created on the thread come from its chunks and freed ones go back to its free lists (regions
+    // of a thread are nested). Its destruction returns the chunks at once and destroys no object
+    // left there: holders of those objects are abandoned with the region and must never be
+    // released. Memory the objects own apart from their blocks, as long strings and field tables,
+    // isn't returned either, so a region suits a run followed by the exit of the process.
+    // Holders kept outside the region, as in the nodes of a program tree, must release its objects
+    // before it's destroyed. A collector of cycles must be made after the region and abandoned
+    // before it
+    class Region {
+    public:
+        Region();
+
+        Region(const Region&) = delete;
+        Region& operator=(const Region&) = delete;
+
+        ~Region();
+
+        // Moves the value into the region, it's never destroyed
+        template <typename T>
+        void Abandon(T&& value) {
+            using Value = std::decay_t<T>;
+            static_assert(alignof(Value) <= alignof(std::max_align_t));
+
+            ::new (Allocate(sizeof(Value))) Value(std::forward<T>(value));
+        }
+
+    private:
+        class Pool;
+
+        void* Allocate(std::size_t size);
+
+        std::unique_ptr<Pool> previous_;
+    };
+
+    // Frees cycles of class instances, which reference counts don't free. Instances made by Own
+    // are tracked by the innermost collector alive on the thread (collectors of a thread are
+    // nested). A collection subtracts the references between the collected instances from their
+    // counts: an instance with references left is referenced from outside, by a closure, a frame
+    // or a temporary of the interpreter, and so is anything reachable from it through fields. The
+    // fields of the other instances are cleared, then their counts free them.
+    // New instances are in the nursery, collected when the instances made since the last
+    // collection exceed a threshold. Survivors move to the old generation, which is collected too
+    // by every full_collection_period-th collection once enough instances were moved there
+    class GarbageCollector {
+    public:
+        struct Config {
+            // new instances per collection of the nursery
+            size_t nursery_threshold = 10'000;
+            // collections of the nursery per collection of both generations
+            size_t full_collection_period = 10;
+            // the nursery is collected before every new instance, for testing
+            bool stress = false;
+        };
+
+        struct Stats {
+            size_t collections = 0;
+            size_t full_collections = 0;
+            size_t freed = 0;
+            std::chrono::nanoseconds total_pause{ 0 };
+            std::chrono::nanoseconds max_pause{ 0 };
+        };
+
+        GarbageCollector();
+        explicit GarbageCollector(Config config);
+
+        GarbageCollector(const GarbageCollector&) = delete;
+        GarbageCollector& operator=(const GarbageCollector&) = delete;
+
+        // Collects both generations, instances left are no longer tracked
+        ~GarbageCollector();
+
+        // Returns the number of freed instances
+        size_t Collect(bool full);
+
+        // Stops tracking the instances without collecting them, for instances dropped with a region
+        void Abandon();
+
+        const Config& GetConfig() const;
+        const Stats& GetStats() const;
+        // Instances in both generations
+        size_t GetTracked() const;
+
+    private:
+        friend class ClassInstance;
+        friend void TrackInstance(ClassInstance& instance);
+
+        static constexpr std::uint8_t NURSERY = 0;
+        static constexpr std::uint8_t OLD = 1;
+
+        struct Generation {
+            ClassInstance* head = nullptr;
+            size_t size = 0;
+        };
+
+        void Track(ClassInstance& instance);
+        void Untrack(ClassInstance& instance);
+        void Link(ClassInstance& instance, std::uint8_t generation);
+        bool IsCollected(const ClassInstance* instance, std::uint8_t oldest) const;
+
+        Config config_;
+        Stats stats_;
+        std::array<Generation, 2> generations_;
+        size_t allocations_ = 0;
+        size_t collections_since_full_ = 0;
+        // instances moved to the old generation since its last collection
+        size_t promoted_since_full_ = 0;
+        bool collecting_ = false;
+        GarbageCollector* previous_;
     };
 
     bool Equal(const ObjectHolder& lhs, const ObjectHolder& rhs, Context& context);
@@ -67,6 +67,64 @@ namespace runtime {
             ASSERT_EQUAL(word.GetValue(), "hello!"s);
         }
 
+        void TestInternedStrings() {
+            DummyContext context;
+            {
+                auto first = String::Intern("key"s);
+                auto second = String::Intern("key"s);
+                ASSERT(first.Get() == second.Get());
+                ASSERT(first.TryAs<String>()->IsInterned());
+
+                auto other = String::Intern("kez"s);
+                ASSERT(!Equal(first, other, context));
+
+                // a string with the same value made otherwise is equal by value
+                auto plain = ObjectHolder::Own(String{ "key"s });
+                ASSERT(!plain.TryAs<String>()->IsInterned());
+                ASSERT(Equal(first, plain, context));
+                ASSERT_EQUAL(first.TryAs<String>()->GetHash(), plain.TryAs<String>()->GetHash());
+            }
+
+            // the released string left the table
+            auto again = String::Intern("key"s);
+            ASSERT_EQUAL(again.TryAs<String>()->GetValue(), "key"s);
+            ASSERT(again.TryAs<String>()->IsInterned());
+        }
+
+        void TestStringRope() {
+            const string piece(100, 'x');
+            auto text = ObjectHolder::Own(String{ "<"s });
+            string expected = "<"s;
+
+            for (int i = 0; i < 1000; ++i) {
+                text = String::Concat(text, ObjectHolder::Own(String{ piece }));
+                expected += piece;
+            }
+
+            auto& rope = *text.TryAs<String>();
+            ASSERT(rope.IsRope());
+            ASSERT_EQUAL(rope.GetSize(), expected.size());
+            ASSERT_EQUAL(rope.GetValue(), expected);
+            ASSERT(!rope.IsRope());
+
+            // short concatenations are flat
+            auto short_text = String::Concat(ObjectHolder::Own(String{ "a"s }), ObjectHolder::Own(String{ "b"s }));
+            ASSERT(!short_text.TryAs<String>()->IsRope());
+
+            // a borrowed string is copied, its later changes don't reach the rope
+            String local(piece + piece + piece);
+            auto joined = String::Concat(ObjectHolder::Share(local), ObjectHolder::Own(String{ "!"s }));
+            local = String{ "changed"s };
+            ASSERT_EQUAL(joined.TryAs<String>()->GetValue(), piece + piece + piece + "!"s);
+
+            // a deep rope that is never flattened is released without recursion
+            auto deep = ObjectHolder::Own(String{ piece + piece + piece });
+            for (int i = 0; i < 200000; ++i) {
+                deep = String::Concat(deep, ObjectHolder::Own(String{ "y"s }));
+            }
+            ASSERT_EQUAL(deep.TryAs<String>()->GetSize(), 300U + 200000U);
+        }
+
         struct TestMethodBody : Executable {
             using Fn = std::function<ObjectHolder(Closure& closure, Context& context)>;
             Fn body;
@@ -253,12 +311,164 @@ namespace runtime {
             }
         }
 
+        void TestShareCopies() {
+            ASSERT_EQUAL(Logger::instance_count, 0);
+            Logger logger(5);
+            {
+                auto one = ObjectHolder::Share(logger);
+                std::vector<ObjectHolder> copies(10, one);
+                ObjectHolder last;
+                last = copies.back();
+                copies.clear();
+
+                ASSERT(last.Get() == &logger);
+                ASSERT(one.Get() == &logger);
+            }
+            ASSERT_EQUAL(Logger::instance_count, 1);
+        }
+
+        void TestReferenceCount() {
+            ASSERT_EQUAL(Logger::instance_count, 0);
+            ObjectHolder kept;
+            {
+                auto owner = ObjectHolder::Own(Logger(1));
+                ASSERT(!owner->IsBorrowed());
+                ObjectHolder copy = owner;
+                // sharing an owned object adds a reference
+                kept = ObjectHolder::Share(*copy);
+                ASSERT_EQUAL(Logger::instance_count, 1);
+            }
+            ASSERT_EQUAL(Logger::instance_count, 1);
+            kept = ObjectHolder::None();
+            ASSERT_EQUAL(Logger::instance_count, 0);
+
+            Logger local(2);
+            ASSERT(local.IsBorrowed());
+            ASSERT(ObjectHolder::Share(local).Get() == &local);
+        }
+
+        void TestObjectPool() {
+            auto first = ObjectHolder::Own(String{ "first"s });
+            const Object* freed = first.Get();
+            first = ObjectHolder::None();
+
+            // a block freed to the pool is the next one of its size class
+            auto second = ObjectHolder::Own(String{ "second"s });
+            ASSERT(second.Get() == freed);
+
+            auto third = ObjectHolder::Own(String{ "third"s });
+            ASSERT(third.Get() != second.Get());
+        }
+
+        void TestRegion() {
+            ASSERT_EQUAL(Logger::instance_count, 0);
+            auto before = ObjectHolder::Own(String{ "before"s });
+            const Object* freed_before = before.Get();
+            before = ObjectHolder::None();
+
+            {
+                Region region;
+
+                // the region has free lists of its own
+                auto inside = ObjectHolder::Own(String{ "inside"s });
+                ASSERT(inside.Get() != freed_before);
+                const Object* freed_inside = inside.Get();
+                inside = ObjectHolder::None();
+                ASSERT(ObjectHolder::Own(String{ "again"s }).Get() == freed_inside);
+
+                region.Abandon(ObjectHolder::Own(Logger(7)));
+                region.Abandon(String::Intern("region"s));
+                ASSERT_EQUAL(Logger::instance_count, 1);
+            }
+
+            // the objects left in the region were dropped without destruction
+            ASSERT_EQUAL(Logger::instance_count, 1);
+            Logger::instance_count = 0;
+
+            // the pool of the thread is back
+            auto after = ObjectHolder::Own(String{ "after"s });
+            ASSERT(after.Get() == freed_before);
+
+            // the interned string left the table with the region
+            auto interned = String::Intern("region"s);
+            ASSERT_EQUAL(interned.TryAs<String>()->GetValue(), "region"s);
+        }
+
+        void TestCycleCollection() {
+            ASSERT_EQUAL(Logger::instance_count, 0);
+            Class cls{ "Node"s, {}, nullptr };
+
+            GarbageCollector::Config config;
+            config.nursery_threshold = 1'000'000;
+            GarbageCollector collector(config);
+
+            // a - b - a is referenced from outside, c references itself only
+            auto a = ObjectHolder::Own(ClassInstance{ cls });
+            auto b = ObjectHolder::Own(ClassInstance{ cls });
+            a.TryAs<ClassInstance>()->Fields()["next"s] = b;
+            a.TryAs<ClassInstance>()->Fields()["log"s] = ObjectHolder::Own(Logger(1));
+            b.TryAs<ClassInstance>()->Fields()["next"s] = a;
+            b = ObjectHolder::None();
+            {
+                auto c = ObjectHolder::Own(ClassInstance{ cls });
+                c.TryAs<ClassInstance>()->Fields()["self"s] = c;
+                c.TryAs<ClassInstance>()->Fields()["log"s] = ObjectHolder::Own(Logger(2));
+            }
+            ASSERT_EQUAL(Logger::instance_count, 2);
+            ASSERT_EQUAL(collector.GetTracked(), 3U);
+
+            ASSERT_EQUAL(collector.Collect(false), 1U);
+            ASSERT_EQUAL(Logger::instance_count, 1);
+            ASSERT_EQUAL(collector.GetTracked(), 2U);
+
+            // the survivors are old now, only a full collection looks at them
+            a = ObjectHolder::None();
+            ASSERT_EQUAL(collector.Collect(false), 0U);
+            ASSERT_EQUAL(Logger::instance_count, 1);
+            ASSERT_EQUAL(collector.Collect(true), 2U);
+            ASSERT_EQUAL(Logger::instance_count, 0);
+            ASSERT_EQUAL(collector.GetTracked(), 0U);
+
+            const auto& stats = collector.GetStats();
+            ASSERT_EQUAL(stats.collections, 3U);
+            ASSERT_EQUAL(stats.full_collections, 1U);
+            ASSERT_EQUAL(stats.freed, 3U);
+            ASSERT(stats.max_pause <= stats.total_pause);
+        }
+
         void TestNullptr() {
             ObjectHolder oh;
             ASSERT(!oh);
             ASSERT(!oh.Get());
         }
 
+        void TestTypeTags() {
+            auto number = ObjectHolder::Own(Number{ 7 });
+            ASSERT(number.TryAs<Number>() != nullptr);
+            ASSERT(number.TryAs<String>() == nullptr);
+            ASSERT(number.TryAs<ClassInstance>() == nullptr);
+
+            Number shared_number{ 8 };
+            auto shared = ObjectHolder::Share(shared_number);
+            ASSERT(shared.TryAs<Number>() == &shared_number);
+            ASSERT(shared.TryAs<Bool>() == nullptr);
+
+            auto str = ObjectHolder::Own(String{ "abc"s });
+            ASSERT(str->GetType() == ObjectType::String);
+            ASSERT(str.TryAs<Number>() == nullptr);
+
+            Class cls{ "Empty"s, {}, nullptr };
+            ASSERT(cls.GetType() == ObjectType::Class);
+            ClassInstance instance{ cls };
+            ASSERT(instance.GetType() == ObjectType::ClassInstance);
+            ASSERT(ObjectHolder::Share(instance).TryAs<Class>() == nullptr);
+
+            // objects without a tag are found by dynamic_cast
+            Logger logger(5);
+            ASSERT(logger.GetType() == ObjectType::Other);
+            ASSERT(ObjectHolder::Share(logger).TryAs<Logger>() == &logger);
+        }
+
         void TestIsBool() {
             ASSERT(IsTrue(ObjectHolder::Own(Bool{ true })));
             ASSERT(!IsTrue(ObjectHolder::Own(Bool{ false })));
@@ -504,6 +714,8 @@ namespace runtime {
     void RunObjectsTests(TestRunner& tr) {
         RUN_TEST(tr, runtime::TestNumber);
         RUN_TEST(tr, runtime::TestString);
+        RUN_TEST(tr, runtime::TestStringRope);
+        RUN_TEST(tr, runtime::TestInternedStrings);
         RUN_TEST(tr, runtime::TestMethodInvocation);
     }
 
@@ -511,7 +723,13 @@ namespace runtime {
         RUN_TEST(tr, runtime::TestNonowning);
         RUN_TEST(tr, runtime::TestOwning);
         RUN_TEST(tr, runtime::TestMove);
+        RUN_TEST(tr, runtime::TestShareCopies);
+        RUN_TEST(tr, runtime::TestReferenceCount);
+        RUN_TEST(tr, runtime::TestObjectPool);
+        RUN_TEST(tr, runtime::TestRegion);
+        RUN_TEST(tr, runtime::TestCycleCollection);
         RUN_TEST(tr, runtime::TestNullptr);
+        RUN_TEST(tr, runtime::TestTypeTags);
     }
 
     void RunUserTests(TestRunner& tr) {
@@ -1,7 +1,10 @@
 #include "statement.h"
 
+#include <algorithm>
+#include <charconv>
 #include <iostream>
 #include <sstream>
+#include <typeinfo>
 
 using namespace std;
 
@@ -14,6 +17,36 @@ namespace ast {
     namespace {
         const string ADD_METHOD = "__add__"s;
         const string INIT_METHOD = "__init__"s;
+        const string SELF_OBJECT = "self"s;
+
+        // Failing dynamic_cast of a node through both of its bases costs more than printing a short line
+        template <typename Node>
+        Node* ExactCast(Statement& node) {
+            return typeid(node) == typeid(Node) ? static_cast<Node*>(&node) : nullptr;
+        }
+
+        // Slow path of Sub, Mult and Div: an overflow of numbers, big numbers or operands of other
+        // types. It is kept out of line, the number path of a node compiles better without it
+        [[gnu::noinline]] ObjectHolder ApplyBigOrThrow(runtime::ArithmeticOp op, const ObjectHolder& lhs,
+                                                       const ObjectHolder& rhs, const char* error) {
+            if (auto result = runtime::ApplyBigArithmetic(op, lhs, rhs)) {
+                return result;
+            }
+
+            throw std::runtime_error(error);
+        }
+
+        // Text of str() for a value that is not None
+        string FormatObject(const ObjectHolder& obj, Context& context) {
+            runtime::DummyContext dummy_context;
+            dummy_context.SetCallStack(context.GetCallStack());
+            dummy_context.SetMemoCache(context.GetMemoCache());
+            dummy_context.SetMethodCompiler(context.GetMethodCompiler());
+
+            obj->Print(dummy_context.GetOutputStream(), dummy_context);
+
+            return dummy_context.output.str();
+        }
     } // namespace
 
     VariableValue::VariableValue(std::string var_name) {
@@ -26,6 +59,10 @@ namespace ast {
 
     ObjectHolder VariableValue::Execute(Closure& closure, Context& /* context */) {
 
+        if (used_slot_ || !stored_prefixes_.empty()) {
+            return ExecuteCached(closure);
+        }
+
         Closure* closure_ptr = &closure;
 
         runtime::Closure::iterator current_obj_it;
@@ -50,15 +87,103 @@ namespace ast {
         return current_obj_it->second;
     }
 
+    const std::vector<std::string>& VariableValue::GetDottedIds() const {
+        return dotted_ids_;
+    }
+
+    void VariableValue::UsePathSlot(size_t prefix_length, PathSlot slot, bool last_use) {
+        used_prefix_ = prefix_length;
+        used_slot_ = std::move(slot);
+        release_used_slot_ = last_use;
+    }
+
+    void VariableValue::AddPathSlot(size_t prefix_length, PathSlot slot) {
+        auto it = std::find_if(stored_prefixes_.begin(), stored_prefixes_.end(), [prefix_length](const auto& stored) {
+            return stored.first >= prefix_length;
+        });
+
+        if (it == stored_prefixes_.end() || it->first != prefix_length) {
+            stored_prefixes_.emplace(it, prefix_length, std::move(slot));
+        }
+    }
+
+    size_t VariableValue::GetUsedPrefixLength() const {
+        return used_prefix_;
+    }
+
+    ObjectHolder VariableValue::ExecuteCached(Closure& closure) const {
+        const ObjectHolder* current = nullptr;
+        size_t length = 0;
+        ObjectHolder released;
+
+        // an empty slot was taken by an earlier evaluation of the same lookup, as when a typed copy
+        // falls back to the original or the JIT checks its result, the lookup walks from the closure
+        if (used_slot_ && *used_slot_) {
+            if (release_used_slot_) {
+                released = std::exchange(*used_slot_, ObjectHolder());
+                current = &released;
+            } else {
+                current = used_slot_.get();
+            }
+            length = used_prefix_;
+        } else {
+            auto it = closure.find(dotted_ids_.front());
+
+            if (it == closure.end()) {
+                throw std::runtime_error("var is not found");
+            }
+
+            current = &it->second;
+            length = 1;
+        }
+
+        auto stored = stored_prefixes_.begin();
+
+        while (true) {
+            for (; stored != stored_prefixes_.end() && stored->first <= length; ++stored) {
+                if (stored->first == length) {
+                    *stored->second = *current;
+                }
+            }
+
+            auto class_inst_current_ptr = current->TryAs<runtime::ClassInstance>();
+
+            if (length == dotted_ids_.size() || class_inst_current_ptr == nullptr) {
+                // the lookup stops at a non-object, longer prefixes have the same value
+                for (; stored != stored_prefixes_.end(); ++stored) {
+                    *stored->second = *current;
+                }
+                return *current;
+            }
+
+            auto it = class_inst_current_ptr->Fields().find(dotted_ids_[length]);
+
+            if (it == class_inst_current_ptr->Fields().end()) {
+                throw std::runtime_error("var is not found");
+            }
+
+            current = &it->second;
+            ++length;
+        }
+    }
+
     Assignment::Assignment(std::string var, std::unique_ptr<Statement> rv)
         : var_(std::move(var))
         , rv_(std::move(rv)) {
     }
 
     ObjectHolder Assignment::Execute(Closure& closure, Context& context) {
-        closure[var_] = std::move(rv_->Execute(closure, context));
+        auto value = rv_->Execute(closure, context);
+
+        // an existing variable keeps its closure node, so assignments in a loop don't allocate
+        auto& slot = closure[var_];
+        slot = std::move(value);
+
+        return slot;
+    }
 
-        return closure.at(var_);
+    void Assignment::ForEachChild(const ChildVisitor& visitor) {
+        visitor(rv_);
     }
 
     FieldAssignment::FieldAssignment(VariableValue object, std::string field_name, std::unique_ptr<Statement> rv)
@@ -77,12 +202,28 @@ namespace ast {
         return clacc_inst_ptr->Fields().at(field_name_);
     }
 
+    void FieldAssignment::ForEachChild(const ChildVisitor& visitor) {
+        visitor(rv_);
+    }
+
+    const VariableValue& FieldAssignment::GetObject() const {
+        return object_;
+    }
+
+    const std::string& FieldAssignment::GetFieldName() const {
+        return field_name_;
+    }
+
+    Statement* FieldAssignment::GetRv() const {
+        return rv_.get();
+    }
+
     NewInstance::NewInstance(const runtime::Class& class_)
-        : class_inst_(class_) {
+        : class_(class_) {
     }
 
     NewInstance::NewInstance(const runtime::Class& class_, std::vector<std::unique_ptr<Statement>> args)
-        : class_inst_(class_)
+        : class_(class_)
         , args_(std::move(args)) {
     }
 
@@ -94,11 +235,75 @@ namespace ast {
             actual_args.push_back(std::move(arg->Execute(closure, context)));
         }
 
-        if (class_inst_.HasMethod(INIT_METHOD, args_.size())) {
-            class_inst_.Call(INIT_METHOD, std::move(actual_args), context);
+        auto instance = runtime::ObjectHolder::Own(runtime::ClassInstance(class_));
+        auto& class_inst = *instance.TryAs<runtime::ClassInstance>();
+
+        if (class_inst.HasMethod(INIT_METHOD, args_.size())) {
+            class_inst.Call(INIT_METHOD, std::move(actual_args), context);
+        }
+
+        return instance;
+    }
+
+    void NewInstance::ForEachChild(const ChildVisitor& visitor) {
+        for (auto& arg : args_) {
+            visitor(arg);
+        }
+    }
+
+    const runtime::Class& NewInstance::GetClass() const {
+        return class_;
+    }
+
+    const std::vector<std::unique_ptr<Statement>>& NewInstance::GetArgs() const {
+        return args_;
+    }
+
+    namespace {
+        MethodCache::Stats total_method_cache_stats;
+    } // namespace
+
+    const runtime::Method* MethodCache::Lookup(const runtime::Class& cls, const std::string& method,
+                                               size_t argument_count) {
+        for (size_t i = 0; i < size_; ++i) {
+            if (entries_[i].cls == &cls) {
+                ++stats_.hits;
+                ++total_method_cache_stats.hits;
+                return entries_[i].method;
+            }
+        }
+
+        ++stats_.misses;
+        ++total_method_cache_stats.misses;
+
+        const runtime::Method* method_ptr = cls.GetMethod(method);
+        if (method_ptr == nullptr || method_ptr->formal_params.size() != argument_count) {
+            return nullptr;
+        }
+
+        if (size_ < MAX_ENTRIES) {
+            entries_[size_++] = { &cls, method_ptr };
+        } else {
+            megamorphic_ = true;
         }
 
-        return runtime::ObjectHolder::Share(class_inst_);
+        return method_ptr;
+    }
+
+    bool MethodCache::IsMegamorphic() const {
+        return megamorphic_;
+    }
+
+    const MethodCache::Stats& MethodCache::GetStats() const {
+        return stats_;
+    }
+
+    const MethodCache::Stats& MethodCache::GetTotalStats() {
+        return total_method_cache_stats;
+    }
+
+    void MethodCache::ResetTotalStats() {
+        total_method_cache_stats = {};
     }
 
     MethodCall::MethodCall(std::unique_ptr<Statement> object, std::string method_name,
@@ -113,15 +318,47 @@ namespace ast {
 
         auto class_ptr = obj.TryAs<runtime::ClassInstance>();
 
+        if (class_ptr == nullptr) {
+            throw std::runtime_error("method "s + method_name_ + " is called for non-object"s);
+        }
+
         std::vector<runtime::ObjectHolder> actual_args;
+        actual_args.reserve(args_.size());
 
         for (const auto& arg : args_) {
             actual_args.push_back(std::move(arg->Execute(closure, context)));
         }
 
-        auto res = class_ptr->Call(method_name_, actual_args, context);
+        const auto* method_ptr = cache_.Lookup(class_ptr->GetClass(), method_name_, args_.size());
+
+        if (method_ptr == nullptr) {
+            throw std::runtime_error("No method found");
+        }
+
+        return class_ptr->Call(*method_ptr, actual_args, context);
+    }
+
+    void MethodCall::ForEachChild(const ChildVisitor& visitor) {
+        visitor(object_);
+        for (auto& arg : args_) {
+            visitor(arg);
+        }
+    }
+
+    Statement* MethodCall::GetObject() const {
+        return object_.get();
+    }
 
-        return res;
+    const std::string& MethodCall::GetMethodName() const {
+        return method_name_;
+    }
+
+    const std::vector<std::unique_ptr<Statement>>& MethodCall::GetArgs() const {
+        return args_;
+    }
+
+    const MethodCache& MethodCall::GetCache() const {
+        return cache_;
     }
 
     void Compound::AddStatement(std::unique_ptr<Statement> stmt) {
@@ -131,11 +368,25 @@ namespace ast {
     ObjectHolder Compound::Execute(Closure& closure, Context& context) {
         for (const auto& statement : statements_) {
             statement->Execute(closure, context);
+
+            if (context.GetLoopSignal() != runtime::LoopSignal::None) {
+                break;
+            }
         }
 
         return {};
     }
 
+    void Compound::ForEachChild(const ChildVisitor& visitor) {
+        for (auto& statement : statements_) {
+            visitor(statement);
+        }
+    }
+
+    std::vector<std::unique_ptr<Statement>>& Compound::Statements() {
+        return statements_;
+    }
+
     RuntimeReturnExeption::RuntimeReturnExeption(const runtime::ObjectHolder& obj)
         : obj_(obj) {
     }
@@ -154,19 +405,105 @@ namespace ast {
         throw RuntimeReturnExeption(obj);
     }
 
+    void Return::ForEachChild(const ChildVisitor& visitor) {
+        visitor(statement_);
+    }
+
+    Statement* Return::GetStatement() const {
+        return statement_.get();
+    }
+
+    RuntimeTailCallException::RuntimeTailCallException(const runtime::Method& method,
+                                                       std::vector<runtime::ObjectHolder> args)
+        : method_(&method)
+        , args_(std::move(args)) {
+    }
+
+    const runtime::Method& RuntimeTailCallException::GetMethod() const {
+        return *method_;
+    }
+
+    std::vector<runtime::ObjectHolder>& RuntimeTailCallException::GetArgs() {
+        return args_;
+    }
+
+    TailCall::TailCall(const runtime::Method& method, std::unique_ptr<Return> original)
+        : method_(method)
+        , original_(std::move(original))
+        , call_(static_cast<MethodCall&>(*original_->GetStatement())) {
+    }
+
+    ObjectHolder TailCall::Execute(Closure& closure, Context& context) {
+        auto self = call_.GetObject()->Execute(closure, context);
+
+        auto self_ptr = self.TryAs<runtime::ClassInstance>();
+
+        if (self_ptr == nullptr) {
+            throw std::runtime_error("method "s + call_.GetMethodName() + " is called for non-object"s);
+        }
+
+        std::vector<runtime::ObjectHolder> actual_args;
+        actual_args.reserve(call_.GetArgs().size());
+
+        for (const auto& arg : call_.GetArgs()) {
+            actual_args.push_back(arg->Execute(closure, context));
+        }
+
+        const auto* method_ptr = cache_.Lookup(self_ptr->GetClass(), call_.GetMethodName(), actual_args.size());
+
+        if (method_ptr == nullptr) {
+            throw std::runtime_error("No method found");
+        }
+
+        if (method_ptr == &method_) {
+            throw RuntimeTailCallException(method_, std::move(actual_args));
+        }
+
+        // self is an instance of a subclass which overrides the method
+        throw RuntimeReturnExeption(self_ptr->Call(*method_ptr, actual_args, context));
+    }
+
+    void TailCall::ForEachChild(const ChildVisitor& visitor) {
+        call_.ForEachChild(visitor);
+    }
+
     MethodBody::MethodBody(std::unique_ptr<Statement>&& body)
         : body_(std::move(body)) {
     }
 
     ObjectHolder MethodBody::Execute(Closure& closure, Context& context) {
 
-        try {
-            body_->Execute(closure, context);
-        } catch (RuntimeReturnExeption& obj) {
-            return obj.GetValue();
+        while (true) {
+            try {
+                body_->Execute(closure, context);
+                return {};
+            } catch (RuntimeReturnExeption& obj) {
+                return obj.GetValue();
+            } catch (RuntimeTailCallException& call) {
+                // Reuse the frame: drop locals of the finished iteration, rebind params in place
+                const auto& params = call.GetMethod().formal_params;
+
+                for (auto it = closure.begin(); it != closure.end();) {
+                    if (it->first != SELF_OBJECT && find(params.begin(), params.end(), it->first) == params.end()) {
+                        it = closure.erase(it);
+                    } else {
+                        ++it;
+                    }
+                }
+
+                for (size_t i = 0; i < params.size(); ++i) {
+                    closure[params[i]] = std::move(call.GetArgs()[i]);
+                }
+            }
         }
+    }
 
-        return {};
+    void MethodBody::ForEachChild(const ChildVisitor& visitor) {
+        visitor(body_);
+    }
+
+    Statement* MethodBody::GetBody() const {
+        return body_.get();
     }
 
     ClassDefinition::ClassDefinition(ObjectHolder cls)
@@ -176,11 +513,21 @@ namespace ast {
     ObjectHolder ClassDefinition::Execute(Closure& closure, Context& /* context */) {
         auto obj = cls_.TryAs<runtime::Class>();
 
-        closure[obj->GetName()] = std::move(cls_);
+        closure[obj->GetName()] = cls_;
 
         return {};
     }
 
+    void ClassDefinition::ForEachChild(const ChildVisitor& visitor) {
+        for (auto& method : GetClass().Methods()) {
+            visitor(method.body);
+        }
+    }
+
+    runtime::Class& ClassDefinition::GetClass() const {
+        return *cls_.TryAs<runtime::Class>();
+    }
+
     Print::Print(unique_ptr<Statement> argument) {
         args_.push_back(std::move(argument));
     }
@@ -195,24 +542,158 @@ namespace ast {
 
     ObjectHolder Print::Execute(Closure& closure, Context& context) {
         ObjectHolder obj;
+        auto& os = context.GetOutputStream();
 
         for (const auto& arg : args_) {
             if (arg != args_.front()) {
-                context.GetOutputStream() << " "s;
+                os << " "sv;
+            }
+
+            const size_t begin = pieces_.size();
+
+            try {
+                if (CollectPieces(*arg, closure, context)) {
+                    auto text = JoinText(begin, pieces_.size(), context);
+                    os.write(text.data(), static_cast<std::streamsize>(text.size()));
+                    obj = {};
+                } else {
+                    obj = std::move(pieces_[begin].value);
+
+                    if (obj) {
+                        obj->Print(os, context);
+                    } else {
+                        os << "None"sv;
+                    }
+                }
+            } catch (...) {
+                pieces_.resize(begin);
+                throw;
+            }
+
+            pieces_.resize(begin);
+        }
+
+        os << "\n"sv;
+
+        return obj;
+    }
+
+    bool Print::CollectPieces(Statement& node, Closure& closure, Context& context) {
+        const size_t begin = pieces_.size();
+
+        if (auto* add = ExactCast<Add>(node)) {
+            bool lhs_string = CollectPieces(*add->GetLhs(), closure, context);
+            const size_t middle = pieces_.size();
+            bool rhs_string = CollectPieces(*add->GetRhs(), closure, context);
+
+            if (lhs_string && rhs_string) {
+                return true;
             }
 
-            obj = arg->Execute(closure, context);
+            // numbers or __add__ of an instance, add the values the usual way
+            auto result = add->Apply(JoinPieces(begin, middle, context), JoinPieces(middle, pieces_.size(), context),
+                                     context);
+            pieces_.resize(begin);
+
+            return AddPiece(std::move(result), false);
+        }
+
+        if (auto* stringify = ExactCast<Stringify>(node)) {
+            auto obj = stringify->GetArgument()->Execute(closure, context);
 
-            if (obj) {
-                obj->Print(context.GetOutputStream(), context);
+            if (!obj) {
+                pieces_.push_back({ {}, "None"sv, true, true });
+            } else if (obj.TryAs<runtime::ClassInstance>() != nullptr) {
+                // __str__ runs now, not when the output is written
+                AddPiece(ObjectHolder::Own(runtime::String{ FormatObject(obj, context) }), true);
             } else {
-                context.GetOutputStream() << "None"s;
+                AddPiece(std::move(obj), true);
             }
+
+            return true;
         }
 
-        context.GetOutputStream() << "\n"s;
+        return AddPiece(node.Execute(closure, context), false);
+    }
+
+    bool Print::AddPiece(ObjectHolder value, bool stringified) {
+        std::string_view text;
+        bool is_text = false;
 
-        return obj;
+        if (auto* str = value.TryAs<runtime::String>()) {
+            text = str->GetValue();
+            is_text = true;
+        }
+
+        pieces_.push_back({ std::move(value), text, is_text, stringified });
+
+        return is_text;
+    }
+
+    ObjectHolder Print::JoinPieces(size_t begin, size_t end, Context& context) {
+        if (end - begin == 1 && !pieces_[begin].stringified) {
+            return pieces_[begin].value;
+        }
+
+        return ObjectHolder::Own(runtime::String{ std::string(JoinText(begin, end, context)) });
+    }
+
+    std::string_view Print::JoinText(size_t begin, size_t end, Context& context) {
+        if (end - begin == 1 && pieces_[begin].is_text) {
+            return pieces_[begin].text;
+        }
+
+        // no user code runs here, a print reentered by the arguments is already done with the buffer
+        buffer_.clear();
+
+        for (size_t i = begin; i < end; ++i) {
+            const auto& piece = pieces_[i];
+
+            if (piece.is_text) {
+                buffer_ += piece.text;
+            } else if (auto* number = piece.value.TryAs<runtime::Number>()) {
+                std::array<char, 24> digits;
+                auto [last, error] = std::to_chars(digits.begin(), digits.end(), number->GetValue());
+                buffer_.append(digits.begin(), last);
+            } else if (auto* boolean = piece.value.TryAs<runtime::Bool>()) {
+                buffer_ += boolean->GetValue() ? "True"sv : "False"sv;
+            } else {
+                // str() of a class object, printing it runs no user code either
+                buffer_ += FormatObject(piece.value, context);
+            }
+        }
+
+        return buffer_;
+    }
+
+    void Print::ForEachChild(const ChildVisitor& visitor) {
+        for (auto& arg : args_) {
+            visitor(arg);
+        }
+    }
+
+    const std::vector<std::unique_ptr<Statement>>& Print::GetArgs() const {
+        return args_;
+    }
+
+    ObjectHolder ReusableResult::NumberResult(std::int64_t value) {
+        return ObjectHolder::Own(runtime::Number{ value });
+    }
+
+    ObjectHolder ReusableResult::StringResult(std::string value) {
+        if (!reuse_) {
+            return ObjectHolder::Own(runtime::String{ std::move(value) });
+        }
+
+        string_ = runtime::String{ std::move(value) };
+        if (!string_holder_) {
+            string_holder_ = ObjectHolder::Share(string_);
+        }
+        return string_holder_;
+    }
+
+    ObjectHolder ReusableResult::BoolResult(bool value) {
+        return ObjectHolder::Own(runtime::Bool{ value });
     }
 
     ObjectHolder Stringify::Execute(Closure& closure, Context& context) {
@@ -220,14 +701,10 @@ namespace ast {
         auto obj = argument_->Execute(closure, context);
 
         if (!obj) {
-            return ObjectHolder::Own(runtime::String{ "None"s });
+            return StringResult("None"s);
         }
 
-        runtime::DummyContext dummy_context;
-
-        obj->Print(dummy_context.GetOutputStream(), dummy_context);
-
-        return ObjectHolder::Own(runtime::String{ dummy_context.output.str() });
+        return StringResult(FormatObject(obj, context));
     }
 
     ObjectHolder Add::Execute(Closure& closure, Context& context) {
@@ -238,24 +715,37 @@ namespace ast {
         auto obj_lhs = lhs_->Execute(closure, context);
         auto obj_rhs = rhs_->Execute(closure, context);
 
+        return Apply(obj_lhs, obj_rhs, context);
+    }
+
+    ObjectHolder Add::Apply(const ObjectHolder& obj_lhs, const ObjectHolder& obj_rhs, Context& context) {
         auto ptr_lhs_n = obj_lhs.TryAs<runtime::Number>();
         auto ptr_rhs_n = obj_rhs.TryAs<runtime::Number>();
 
         if (ptr_lhs_n != nullptr && ptr_rhs_n != nullptr) {
-            auto l_num = ptr_lhs_n->GetValue();
-            auto r_num = ptr_rhs_n->GetValue();
+            std::int64_t result;
 
-            return ObjectHolder::Own(runtime::Number{ l_num + r_num });
+            if (!__builtin_add_overflow(ptr_lhs_n->GetValue(), ptr_rhs_n->GetValue(), &result)) {
+                return NumberResult(result);
+            }
         }
 
         auto ptr_lhs_s = obj_lhs.TryAs<runtime::String>();
         auto ptr_rhs_s = obj_rhs.TryAs<runtime::String>();
 
         if (ptr_lhs_s != nullptr && ptr_rhs_s != nullptr) {
-            auto l_str = ptr_lhs_s->GetValue();
-            auto r_str = ptr_rhs_s->GetValue();
+            if (!IsResultReused()) {
+                return runtime::String::Concat(obj_lhs, obj_rhs);
+            }
+
+            const auto& l_str = ptr_lhs_s->GetValue();
+            const auto& r_str = ptr_rhs_s->GetValue();
 
-            return ObjectHolder::Own(runtime::String{ l_str + r_str });
+            return StringResult(l_str + r_str);
+        }
+
+        if (auto result = runtime::ApplyBigArithmetic(runtime::ArithmeticOp::Add, obj_lhs, obj_rhs)) {
+            return result;
         }
 
         auto ptr_lhs_class_inst = obj_lhs.TryAs<runtime::ClassInstance>();
@@ -283,13 +773,14 @@ namespace ast {
         auto ptr_rhs_n = obj_rhs.TryAs<runtime::Number>();
 
         if (ptr_lhs_n != nullptr && ptr_rhs_n != nullptr) {
-            auto l_num = ptr_lhs_n->GetValue();
-            auto r_num = ptr_rhs_n->GetValue();
+            std::int64_t result;
 
-            return ObjectHolder::Own(runtime::Number{ l_num - r_num });
+            if (!__builtin_sub_overflow(ptr_lhs_n->GetValue(), ptr_rhs_n->GetValue(), &result)) {
+                return NumberResult(result);
+            }
         }
 
-        throw std::runtime_error("incorrect sub operands"s);
+        return ApplyBigOrThrow(runtime::ArithmeticOp::Sub, obj_lhs, obj_rhs, "incorrect sub operands");
     }
 
     ObjectHolder Mult::Execute(Closure& closure, Context& context) {
@@ -304,13 +795,14 @@ namespace ast {
         auto ptr_rhs_n = obj_rhs.TryAs<runtime::Number>();
 
         if (ptr_lhs_n != nullptr && ptr_rhs_n != nullptr) {
-            auto l_num = ptr_lhs_n->GetValue();
-            auto r_num = ptr_rhs_n->GetValue();
+            std::int64_t result;
 
-            return ObjectHolder::Own(runtime::Number{ l_num * r_num });
+            if (!__builtin_mul_overflow(ptr_lhs_n->GetValue(), ptr_rhs_n->GetValue(), &result)) {
+                return NumberResult(result);
+            }
         }
 
-        throw std::runtime_error("incorrect mult operands"s);
+        return ApplyBigOrThrow(runtime::ArithmeticOp::Mult, obj_lhs, obj_rhs, "incorrect mult operands");
     }
 
     ObjectHolder Div::Execute(Closure& closure, Context& context) {
@@ -332,71 +824,53 @@ namespace ast {
                 throw std::runtime_error("division by zero"s);
             }
 
-            return ObjectHolder::Own(runtime::Number{ l_num / r_num });
+            // the only quotient out of range
+            if (l_num != INT64_MIN || r_num != -1) {
+                return NumberResult(l_num / r_num);
+            }
         }
 
-        throw std::runtime_error("incorrect div operands"s);
+        return ApplyBigOrThrow(runtime::ArithmeticOp::Div, obj_lhs, obj_rhs, "incorrect div operands");
     }
 
     ObjectHolder Or::Execute(Closure& closure, Context& context) {
-        if (!rhs_ || !lhs_) {
-            throw std::runtime_error("null operands are not supported"s);
-        }
-        auto l_obj = lhs_->Execute(closure, context);
-        auto r_obj = rhs_->Execute(closure, context);
-
-        if (runtime::IsTrue(l_obj)) {
-            return ObjectHolder::Own(runtime::Bool{ true });
-        }
-
-        if (runtime::IsTrue(r_obj)) {
-            return ObjectHolder::Own(runtime::Bool{ true });
-        }
-
-        return ObjectHolder::Own(runtime::Bool{ false });
+        return BoolResult(ExecuteCondition(closure, context));
     }
 
-    ObjectHolder And::Execute(Closure& closure, Context& context) {
+    bool Or::ExecuteCondition(Closure& closure, Context& context) {
         if (!rhs_ || !lhs_) {
             throw std::runtime_error("null operands are not supported"s);
         }
-        auto l_obj = lhs_->Execute(closure, context);
-        auto r_obj = rhs_->Execute(closure, context);
+        bool l_res = lhs_->ExecuteCondition(closure, context);
+        bool r_res = rhs_->ExecuteCondition(closure, context);
 
-        if (runtime::IsTrue(l_obj) && runtime::IsTrue(r_obj)) {
-            return ObjectHolder::Own(runtime::Bool{ true });
-        }
+        return l_res || r_res;
+    }
 
-        return ObjectHolder::Own(runtime::Bool{ false });
+    ObjectHolder And::Execute(Closure& closure, Context& context) {
+        return BoolResult(ExecuteCondition(closure, context));
     }
 
-    ObjectHolder Not::Execute(Closure& closure, Context& context) {
-        if (!argument_) {
+    bool And::ExecuteCondition(Closure& closure, Context& context) {
+        if (!rhs_ || !lhs_) {
             throw std::runtime_error("null operands are not supported"s);
         }
-        auto obj = argument_->Execute(closure, context);
-
-        auto res = runtime::IsTrue(obj);
+        bool l_res = lhs_->ExecuteCondition(closure, context);
+        bool r_res = rhs_->ExecuteCondition(closure, context);
 
-        return ObjectHolder::Own(runtime::Bool{ !res });
+        return l_res && r_res;
     }
 
-    Comparison::Comparison(Comparator cmp, unique_ptr<Statement> lhs, unique_ptr<Statement> rhs)
-        : BinaryOperation(std::move(lhs), std::move(rhs))
-        , cmp_(std::move(cmp)) {
+    ObjectHolder Not::Execute(Closure& closure, Context& context) {
+        return BoolResult(ExecuteCondition(closure, context));
     }
 
-    ObjectHolder Comparison::Execute(Closure& closure, Context& context) {
-        if (!rhs_ || !lhs_) {
+    bool Not::ExecuteCondition(Closure& closure, Context& context) {
+        if (!argument_) {
             throw std::runtime_error("null operands are not supported"s);
         }
 
-        auto l_obj = lhs_->Execute(closure, context);
-        auto r_obj = rhs_->Execute(closure, context);
-
-        bool res = cmp_(l_obj, r_obj, context);
-
-        return ObjectHolder::Own(runtime::Bool{ res });
+        return !argument_->ExecuteCondition(closure, context);
     }
 
     IfElse::IfElse(std::unique_ptr<Statement> condition, std::unique_ptr<Statement> if_body,
@@ -407,9 +881,7 @@ namespace ast {
     }
 
     ObjectHolder IfElse::Execute(Closure& closure, Context& context) {
-        auto bool_condition = condition_->Execute(closure, context);
-
-        if (runtime::IsTrue(bool_condition)) {
+        if (condition_->ExecuteCondition(closure, context)) {
             return if_body_->Execute(closure, context);
         } else if (else_body_) { // may be empty !!!
             return else_body_->Execute(closure, context);
@@ -418,4 +890,328 @@ namespace ast {
         }
     }
 
+    void IfElse::ForEachChild(const ChildVisitor& visitor) {
+        visitor(condition_);
+        visitor(if_body_);
+        if (else_body_) {
+            visitor(else_body_);
+        }
+    }
+
+    Statement* IfElse::GetCondition() const {
+        return condition_.get();
+    }
+
+    Statement* IfElse::GetIfBody() const {
+        return if_body_.get();
+    }
+
+    Statement* IfElse::GetElseBody() const {
+        return else_body_.get();
+    }
+
+    std::unique_ptr<Statement> IfElse::ReleaseBranch(bool condition) {
+        return condition ? std::move(if_body_) : std::move(else_body_);
+    }
+
+    While::While(std::unique_ptr<Statement> condition, std::unique_ptr<Statement> body)
+        : condition_(std::move(condition))
+        , body_(std::move(body)) {
+    }
+
+    ObjectHolder While::Execute(Closure& closure, Context& context) {
+        while (condition_->ExecuteCondition(closure, context)) {
+            body_->Execute(closure, context);
+
+            runtime::LoopSignal signal = context.GetLoopSignal();
+            if (signal != runtime::LoopSignal::None) {
+                context.SetLoopSignal(runtime::LoopSignal::None);
+
+                if (signal == runtime::LoopSignal::Break) {
+                    break;
+                }
+            }
+        }
+
+        return {};
+    }
+
+    void While::ForEachChild(const ChildVisitor& visitor) {
+        visitor(condition_);
+        visitor(body_);
+    }
+
+    Statement* While::GetCondition() const {
+        return condition_.get();
+    }
+
+    Statement* While::GetBody() const {
+        return body_.get();
+    }
+
+    ObjectHolder Break::Execute(Closure& /* closure */, Context& context) {
+        context.SetLoopSignal(runtime::LoopSignal::Break);
+
+        return {};
+    }
+
+    ObjectHolder Continue::Execute(Closure& /* closure */, Context& context) {
+        context.SetLoopSignal(runtime::LoopSignal::Continue);
+
+        return {};
+    }
+
+    FieldIncrement::FieldIncrement(std::unique_ptr<FieldAssignment> original, std::int64_t delta)
+        : object_(original->GetObject())
+        , field_name_(original->GetFieldName())
+        , delta_(delta)
+        , original_(std::move(original)) {
+    }
+
+    ObjectHolder FieldIncrement::Execute(Closure& closure, Context& context) {
+        auto obj = object_.Execute(closure, context);
+
+        if (auto class_inst_ptr = obj.TryAs<runtime::ClassInstance>()) {
+            auto& fields = class_inst_ptr->Fields();
+
+            if (auto it = fields.find(field_name_); it != fields.end()) {
+                std::int64_t result;
+                auto ptr_n = it->second.TryAs<runtime::Number>();
+
+                if (ptr_n != nullptr && !__builtin_add_overflow(ptr_n->GetValue(), delta_, &result)) {
+                    it->second = ObjectHolder::Own(runtime::Number{ result });
+                    return it->second;
+                }
+            }
+        }
+
+        return original_->Execute(closure, context);
+    }
+
+    FieldCopy::FieldCopy(VariableValue object, std::string field_name, VariableValue source)
+        : object_(std::move(object))
+        , field_name_(std::move(field_name))
+        , source_(std::move(source)) {
+    }
+
+    ObjectHolder FieldCopy::Execute(Closure& closure, Context& context) {
+        auto obj = object_.Execute(closure, context);
+
+        auto class_inst_ptr = obj.TryAs<runtime::ClassInstance>();
+
+        if (class_inst_ptr == nullptr) {
+            throw std::runtime_error("field "s + field_name_ + " is assigned for non-object"s);
+        }
+
+        auto [it, inserted] = class_inst_ptr->Fields().insert_or_assign(field_name_, source_.Execute(closure, context));
+
+        return it->second;
+    }
+
+    SelfMethodCall::SelfMethodCall(std::unique_ptr<MethodCall> original)
+        : original_(std::move(original)) {
+
+        Closure empty;
+        runtime::DummyContext context;
+
+        for (const auto& arg : original_->GetArgs()) {
+            actual_args_.push_back(arg->Execute(empty, context));
+        }
+    }
+
+    ObjectHolder SelfMethodCall::Execute(Closure& closure, Context& context) {
+        auto it = closure.find(SELF_OBJECT);
+
+        runtime::ClassInstance* self_ptr = it != closure.end() ? it->second.TryAs<runtime::ClassInstance>() : nullptr;
+
+        if (self_ptr == nullptr) {
+            throw std::runtime_error("method "s + original_->GetMethodName() + " is called for non-object"s);
+        }
+
+        const auto* method_ptr = cache_.Lookup(self_ptr->GetClass(), original_->GetMethodName(), actual_args_.size());
+
+        if (method_ptr == nullptr) {
+            throw std::runtime_error("No method found");
+        }
+
+        return self_ptr->Call(*method_ptr, actual_args_, context);
+    }
+
+    const MethodCache& SelfMethodCall::GetCache() const {
+        return cache_;
+    }
+
+    const FieldAssignment& FieldIncrement::GetOriginal() const {
+        return *original_;
+    }
+
+    const std::string& FieldCopy::GetFieldName() const {
+        return field_name_;
+    }
+
+    const VariableValue& FieldCopy::GetSource() const {
+        return source_;
+    }
+
+    InlinedMethodCall::InlinedMethodCall(std::unique_ptr<MethodCall> original, const runtime::Class& cls,
+                                         std::unique_ptr<Statement> body, bool returns_value)
+        : original_(std::move(original))
+        , cls_(cls)
+        , body_(std::move(body))
+        , returns_value_(returns_value) {
+    }
+
+    ObjectHolder InlinedMethodCall::Execute(Closure& closure, Context& context) {
+        if (!deoptimized_) {
+            // receiver is a variable path, evaluating it twice has no side effects
+            auto object = original_->GetObject()->Execute(closure, context);
+            auto* instance = object.TryAs<runtime::ClassInstance>();
+
+            if (instance != nullptr && &instance->GetClass() == &cls_) {
+                auto result = body_->Execute(closure, context);
+                return returns_value_ ? result : ObjectHolder::None();
+            }
+
+            deoptimized_ = true;
+        }
+
+        return original_->Execute(closure, context);
+    }
+
+    void InlinedMethodCall::ForEachChild(const ChildVisitor& visitor) {
+        original_->ForEachChild(visitor);
+        visitor(body_);
+    }
+
+    bool InlinedMethodCall::IsDeoptimized() const {
+        return deoptimized_;
+    }
+
+    IntConst::IntConst(std::int64_t value)
+        : value_(value) {
+    }
+
+    std::int64_t IntConst::Evaluate(Closure& /* closure */, Context& /* context */) const {
+        return value_;
+    }
+
+    std::int64_t IntConst::GetValue() const {
+        return value_;
+    }
+
+    IntVariable::IntVariable(VariableValue var)
+        : var_(std::move(var)) {
+    }
+
+    std::int64_t IntVariable::Evaluate(Closure& closure, Context& context) const {
+        // an immediate number lives in the holder
+        auto value = var_.Execute(closure, context);
+        auto* number = value.TryAs<runtime::Number>();
+
+        if (number == nullptr) {
+            throw TypeGuardFailure();
+        }
+
+        return number->GetValue();
+    }
+
+    UnboxedInt::UnboxedInt(std::unique_ptr<IntExpression> expression, std::unique_ptr<Statement> original)
+        : expression_(std::move(expression))
+        , original_(std::move(original)) {
+    }
+
+    ObjectHolder UnboxedInt::Execute(Closure& closure, Context& context) {
+        std::int64_t value;
+
+        try {
+            value = compiled_.function != nullptr ? compiled_.Run(closure, context)
+                                                  : expression_->Evaluate(closure, context);
+        } catch (const TypeGuardFailure&) {
+            return original_->Execute(closure, context);
+        }
+
+        if (compiled_.verify) {
+            std::int64_t expected;
+
+            try {
+                expected = expression_->Evaluate(closure, context);
+            } catch (const TypeGuardFailure&) {
+                throw CompiledCodeMismatch("compiled expression passed a guard the interpreter failed");
+            }
+
+            if (value != expected) {
+                throw CompiledCodeMismatch("compiled expression differs from the interpreter");
+            }
+        }
+
+        return NumberResult(value);
+    }
+
+    const IntExpression& UnboxedInt::GetExpression() const {
+        return *expression_;
+    }
+
+    void UnboxedInt::SetCompiled(CompiledInt compiled) {
+        compiled_ = std::move(compiled);
+    }
+
+    std::int64_t CompiledInt::Run(Closure& closure, Context& context) const {
+        std::array<std::int64_t, MAX_INPUTS> values;
+
+        for (size_t i = 0; i < inputs.size(); ++i) {
+            values[i] = inputs[i]->Evaluate(closure, context);
+        }
+
+        int error = ERROR_NONE;
+        std::int64_t result = function(values.data(), &error);
+
+        if (error == ERROR_DIVISION_BY_ZERO) {
+            throw std::runtime_error("division by zero");
+        }
+        if (error == ERROR_OVERFLOW) {
+            throw TypeGuardFailure();
+        }
+
+        return result;
+    }
+
+    StringConcat::StringConcat(std::vector<Part> parts, std::unique_ptr<Statement> original)
+        : parts_(std::move(parts))
+        , original_(std::move(original)) {
+    }
+
+    ObjectHolder StringConcat::Execute(Closure& closure, Context& context) {
+        // a long string in front is joined as a rope, not copied
+        ObjectHolder head;
+        std::string result;
+
+        for (const auto& part : parts_) {
+            auto obj = part.value->Execute(closure, context);
+
+            if (auto* str = obj.TryAs<runtime::String>()) {
+                if (&part == &parts_.front() && str->GetSize() >= runtime::String::ROPE_THRESHOLD
+                    && !IsResultReused()) {
+                    head = std::move(obj);
+                    continue;
+                }
+                result += str->GetValue();
+            } else if (!part.stringify) {
+                return original_->Execute(closure, context);
+            } else if (auto* number = obj.TryAs<runtime::Number>()) {
+                result += std::to_string(number->GetValue());
+            } else if (auto* boolean = obj.TryAs<runtime::Bool>()) {
+                result += boolean->GetValue() ? "True"sv : "False"sv;
+            } else {
+                // parts are plain reads, running the original expression repeats no side effects
+                return original_->Execute(closure, context);
+            }
+        }
+
+        if (head) {
+            return runtime::String::Concat(head, ObjectHolder::Own(runtime::String{ std::move(result) }));
+        }
+
+        return StringResult(std::move(result));
+    }
+
 } // namespace ast
\ No newline at end of file
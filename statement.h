@@ -2,7 +2,9 @@
 
 #include "runtime.h"
 
-#include <functional>
+#include <array>
+#include <stdexcept>
+#include <string_view>
 
 namespace ast {
     using Statement = runtime::Executable;
@@ -11,16 +13,35 @@ namespace ast {
     class ValueStatement : public Statement {
     public:
         explicit ValueStatement(T v)
-            : value_(std::move(v)) {
+            : value_(std::move(v))
+            , holder_(MakeHolder(value_)) {
         }
 
+        // holder_ refers to value_ of the same node or to a string interned for it
+        ValueStatement(const ValueStatement&) = delete;
+        ValueStatement& operator=(const ValueStatement&) = delete;
+
         runtime::ObjectHolder Execute(runtime::Closure& /*closure*/,
                                       runtime::Context& /*context*/) override {
-            return runtime::ObjectHolder::Share(value_);
+            return holder_;
+        }
+
+        const T& GetValue() const {
+            return value_;
         }
 
     private:
+        // numbers and bools are copied into an immediate, string literals are interned
+        static runtime::ObjectHolder MakeHolder(T& value) {
+            if constexpr (std::is_same_v<T, runtime::String>) {
+                return runtime::String::Intern(value.GetValue());
+            } else {
+                return runtime::ObjectHolder::Own(T{ value.GetValue() });
+            }
+        }
+
         T value_;
+        runtime::ObjectHolder holder_;
     };
 
     using NumericConst = ValueStatement<runtime::Number>;
@@ -42,8 +63,33 @@ namespace ast {
 
         runtime::ObjectHolder Execute(runtime::Closure& closure, runtime::Context& context) override;
 
+        const std::vector<std::string>& GetDottedIds() const;
+
+        // Slot of the path cache shared by lookups of the same path prefix (see
+        // optimize::EliminateCommonPaths). The last lookup using a slot empties it, so the cache
+        // keeps no value past the straight-line code it serves. A lookup finding its slot empty
+        // walks the whole path from the closure
+        using PathSlot = std::shared_ptr<runtime::ObjectHolder>;
+
+        // Starts the lookup from the value of the first prefix_length ids kept in the slot,
+        // the last use takes the value out of the slot
+        void UsePathSlot(size_t prefix_length, PathSlot slot, bool last_use);
+
+        // Stores the value of the first prefix_length ids into the slot on the way
+        void AddPathSlot(size_t prefix_length, PathSlot slot);
+
+        // Length of the prefix taken from a slot, 0 if the lookup starts from the closure
+        size_t GetUsedPrefixLength() const;
+
     private:
+        runtime::ObjectHolder ExecuteCached(runtime::Closure& closure) const;
+
         std::vector<std::string> dotted_ids_;
+
+        size_t used_prefix_ = 0;
+        PathSlot used_slot_;
+        bool release_used_slot_ = false;
+        std::vector<std::pair<size_t, PathSlot>> stored_prefixes_;
     };
 
     class Assignment : public Statement {
@@ -51,6 +97,7 @@ namespace ast {
         Assignment(std::string var, std::unique_ptr<Statement> rv);
 
         runtime::ObjectHolder Execute(runtime::Closure& closure, runtime::Context& context) override;
+        void ForEachChild(const ChildVisitor& visitor) override;
 
     public:
         std::string var_;
@@ -62,6 +109,11 @@ namespace ast {
         FieldAssignment(VariableValue object, std::string field_name, std::unique_ptr<Statement> rv);
 
         runtime::ObjectHolder Execute(runtime::Closure& closure, runtime::Context& context) override;
+        void ForEachChild(const ChildVisitor& visitor) override;
+
+        const VariableValue& GetObject() const;
+        const std::string& GetFieldName() const;
+        Statement* GetRv() const;
 
     private:
         VariableValue object_;
@@ -75,23 +127,69 @@ namespace ast {
         NewInstance(const runtime::Class& class_, std::vector<std::unique_ptr<Statement>> args);
 
         runtime::ObjectHolder Execute(runtime::Closure& closure, runtime::Context& context) override;
+        void ForEachChild(const ChildVisitor& visitor) override;
+
+        const runtime::Class& GetClass() const;
+        const std::vector<std::unique_ptr<Statement>>& GetArgs() const;
 
     private:
-        runtime::ClassInstance class_inst_;
+        const runtime::Class& class_;
         std::vector<std::unique_ptr<Statement>> args_;
     };
 
+    // Inline cache of a call site: remembers methods resolved for the last few receiver classes,
+    // so a repeated call skips lookups by name. Beyond MAX_ENTRIES classes the site is megamorphic
+    // and every call is resolved by name again
+    class MethodCache {
+    public:
+        struct Stats {
+            size_t hits = 0;
+            size_t misses = 0;
+        };
+
+        static constexpr size_t MAX_ENTRIES = 4;
+
+        // Returns nullptr if the class has no method with such name and arguments count
+        const runtime::Method* Lookup(const runtime::Class& cls, const std::string& method,
+                                      size_t argument_count);
+
+        bool IsMegamorphic() const;
+        const Stats& GetStats() const;
+
+        // Counters summed over all call sites
+        static const Stats& GetTotalStats();
+        static void ResetTotalStats();
+
+    private:
+        struct Entry {
+            const runtime::Class* cls = nullptr;
+            const runtime::Method* method = nullptr;
+        };
+
+        std::array<Entry, MAX_ENTRIES> entries_;
+        size_t size_ = 0;
+        bool megamorphic_ = false;
+        Stats stats_;
+    };
+
     class MethodCall : public Statement {
     public:
         MethodCall(std::unique_ptr<Statement> object, std::string method,
                    std::vector<std::unique_ptr<Statement>> args);
 
         runtime::ObjectHolder Execute(runtime::Closure& closure, runtime::Context& context) override;
+        void ForEachChild(const ChildVisitor& visitor) override;
+
+        Statement* GetObject() const;
+        const std::string& GetMethodName() const;
+        const std::vector<std::unique_ptr<Statement>>& GetArgs() const;
+        const MethodCache& GetCache() const;
 
     private:
         std::unique_ptr<Statement> object_;
         std::string method_name_;
         std::vector<std::unique_ptr<Statement>> args_;
+        MethodCache cache_;
     };
 
     class Compound : public Statement {
@@ -105,6 +203,9 @@ namespace ast {
 
         void AddStatement(std::unique_ptr<Statement> stmt);
         runtime::ObjectHolder Execute(runtime::Closure& closure, runtime::Context& context) override;
+        void ForEachChild(const ChildVisitor& visitor) override;
+
+        std::vector<std::unique_ptr<Statement>>& Statements();
 
     private:
         template <typename T0, typename... Ts>
@@ -136,16 +237,53 @@ namespace ast {
         explicit Return(std::unique_ptr<Statement> statement);
 
         runtime::ObjectHolder Execute(runtime::Closure& closure, runtime::Context& context) override;
+        void ForEachChild(const ChildVisitor& visitor) override;
+
+        Statement* GetStatement() const;
 
     private:
         std::unique_ptr<Statement> statement_;
     };
 
+    // Thrown by TailCall to restart the running method with new arguments
+    class RuntimeTailCallException : public std::exception {
+    public:
+        RuntimeTailCallException(const runtime::Method& method, std::vector<runtime::ObjectHolder> args);
+
+        const runtime::Method& GetMethod() const;
+        std::vector<runtime::ObjectHolder>& GetArgs();
+
+    private:
+        const runtime::Method* method_;
+        std::vector<runtime::ObjectHolder> args_;
+    };
+
+    // return self.method(args) inside the same method, produced by the optimizer (see optimize.h).
+    // If self resolves the call to the running method, the current frame is reused for
+    // the next call instead of growing the native stack
+    class TailCall : public Statement {
+    public:
+        // original returns a method call of self
+        TailCall(const runtime::Method& method, std::unique_ptr<Return> original);
+
+        runtime::ObjectHolder Execute(runtime::Closure& closure, runtime::Context& context) override;
+        void ForEachChild(const ChildVisitor& visitor) override;
+
+    private:
+        const runtime::Method& method_;
+        std::unique_ptr<Return> original_;
+        MethodCall& call_;
+        MethodCache cache_;
+    };
+
     class MethodBody : public Statement {
     public:
         explicit MethodBody(std::unique_ptr<Statement>&& body);
 
         runtime::ObjectHolder Execute(runtime::Closure& closure, runtime::Context& context) override;
+        void ForEachChild(const ChildVisitor& visitor) override;
+
+        Statement* GetBody() const;
 
     private:
         std::unique_ptr<Statement> body_;
@@ -157,6 +295,11 @@ namespace ast {
 
         runtime::ObjectHolder Execute(runtime::Closure& closure, runtime::Context& context) override;
 
+        // Visits bodies of the class methods
+        void ForEachChild(const ChildVisitor& visitor) override;
+
+        runtime::Class& GetClass() const;
+
     private:
         runtime::ObjectHolder cls_;
     };
@@ -167,29 +310,107 @@ namespace ast {
         explicit Print(std::vector<std::unique_ptr<Statement>> args);
 
         static std::unique_ptr<Print> Variable(const std::string& name);
+
+        // String additions and str() in the arguments aren't built into new strings: their
+        // leaves are evaluated first, then written out at once through a buffer kept by the node
         runtime::ObjectHolder Execute(runtime::Closure& closure, runtime::Context& context) override;
+        void ForEachChild(const ChildVisitor& visitor) override;
+
+        const std::vector<std::unique_ptr<Statement>>& GetArgs() const;
 
     private:
+        // Leaf of an argument, either a value or a fixed text
+        struct Piece {
+            runtime::ObjectHolder value;
+            std::string_view text; // fixed text or the text of a string value
+            bool is_text = false;
+            bool stringified = false; // the piece stands for str() of the value
+        };
+
+        // Appends the leaves of the node to pieces_, returns true if together they form a string.
+        // Otherwise the node value is added as a single piece
+        bool CollectPieces(Statement& node, runtime::Closure& closure, runtime::Context& context);
+        // Returns true if the value is a string
+        bool AddPiece(runtime::ObjectHolder value, bool stringified);
+        runtime::ObjectHolder JoinPieces(size_t begin, size_t end, runtime::Context& context);
+        // Text of the pieces, valid until the next call
+        std::string_view JoinText(size_t begin, size_t end, runtime::Context& context);
+
         std::vector<std::unique_ptr<Statement>> args_;
+        // used as a stack, a print reached from a method called by the arguments appends above
+        std::vector<Piece> pieces_;
+        std::string buffer_;
     };
 
-    class UnaryOperation : public Statement {
+    // Result storage of a node producing numbers, strings or bools. Numbers and bools are
+    // immediates and never allocate. By default every string result is a new heap object. If the
+    // escape analysis (see optimize::ReuseTemporaries) proves that the result is consumed before
+    // the node can run again, the node keeps it in place
+    class ReusableResult {
+    public:
+        void EnableResultReuse() {
+            reuse_ = true;
+        }
+
+        void DisableResultReuse() {
+            reuse_ = false;
+        }
+
+        bool IsResultReused() const {
+            return reuse_;
+        }
+
+    protected:
+        runtime::ObjectHolder NumberResult(std::int64_t value);
+        runtime::ObjectHolder StringResult(std::string value);
+        runtime::ObjectHolder BoolResult(bool value);
+
+    private:
+        bool reuse_ = false;
+
+        // the holder is made once, sharing an object anew would allocate a control block every time
+        runtime::String string_{ std::string() };
+        runtime::ObjectHolder string_holder_;
+    };
+
+    class UnaryOperation : public Statement, public ReusableResult {
     public:
         explicit UnaryOperation(std::unique_ptr<Statement> argument)
             : argument_(std::move(argument)) {
         }
 
+        void ForEachChild(const ChildVisitor& visitor) override {
+            visitor(argument_);
+        }
+
+        Statement* GetArgument() const {
+            return argument_.get();
+        }
+
     protected:
         std::unique_ptr<Statement> argument_;
     };
 
-    class BinaryOperation : public Statement {
+    class BinaryOperation : public Statement, public ReusableResult {
     public:
         BinaryOperation(std::unique_ptr<Statement> lhs, std::unique_ptr<Statement> rhs)
             : lhs_(std::move(lhs))
             , rhs_(std::move(rhs)) {
         }
 
+        void ForEachChild(const ChildVisitor& visitor) override {
+            visitor(lhs_);
+            visitor(rhs_);
+        }
+
+        Statement* GetLhs() const {
+            return lhs_.get();
+        }
+
+        Statement* GetRhs() const {
+            return rhs_.get();
+        }
+
     protected:
         std::unique_ptr<Statement> lhs_;
         std::unique_ptr<Statement> rhs_;
@@ -207,6 +428,10 @@ namespace ast {
         using BinaryOperation::BinaryOperation;
 
         runtime::ObjectHolder Execute(runtime::Closure& closure, runtime::Context& context) override;
+
+        // Adds already evaluated operands
+        runtime::ObjectHolder Apply(const runtime::ObjectHolder& lhs, const runtime::ObjectHolder& rhs,
+                                    runtime::Context& context);
     };
 
     class Sub : public BinaryOperation {
@@ -235,6 +460,7 @@ namespace ast {
         using BinaryOperation::BinaryOperation;
 
         runtime::ObjectHolder Execute(runtime::Closure& closure, runtime::Context& context) override;
+        bool ExecuteCondition(runtime::Closure& closure, runtime::Context& context) override;
     };
 
     class And : public BinaryOperation {
@@ -242,6 +468,7 @@ namespace ast {
         using BinaryOperation::BinaryOperation;
 
         runtime::ObjectHolder Execute(runtime::Closure& closure, runtime::Context& context) override;
+        bool ExecuteCondition(runtime::Closure& closure, runtime::Context& context) override;
     };
 
     class Not : public UnaryOperation {
@@ -249,27 +476,142 @@ namespace ast {
         using UnaryOperation::UnaryOperation;
 
         runtime::ObjectHolder Execute(runtime::Closure& closure, runtime::Context& context) override;
+        bool ExecuteCondition(runtime::Closure& closure, runtime::Context& context) override;
     };
 
+    namespace compare {
+        struct Equal {
+            template <typename T>
+            static bool Apply(const T& lhs, const T& rhs) {
+                return lhs == rhs;
+            }
+
+            static bool Generic(const runtime::ObjectHolder& lhs, const runtime::ObjectHolder& rhs,
+                                runtime::Context& context) {
+                return runtime::Equal(lhs, rhs, context);
+            }
+        };
+
+        struct NotEqual {
+            template <typename T>
+            static bool Apply(const T& lhs, const T& rhs) {
+                return lhs != rhs;
+            }
+
+            static bool Generic(const runtime::ObjectHolder& lhs, const runtime::ObjectHolder& rhs,
+                                runtime::Context& context) {
+                return runtime::NotEqual(lhs, rhs, context);
+            }
+        };
+
+        struct Less {
+            template <typename T>
+            static bool Apply(const T& lhs, const T& rhs) {
+                return lhs < rhs;
+            }
+
+            static bool Generic(const runtime::ObjectHolder& lhs, const runtime::ObjectHolder& rhs,
+                                runtime::Context& context) {
+                return runtime::Less(lhs, rhs, context);
+            }
+        };
+
+        struct Greater {
+            template <typename T>
+            static bool Apply(const T& lhs, const T& rhs) {
+                return lhs > rhs;
+            }
+
+            static bool Generic(const runtime::ObjectHolder& lhs, const runtime::ObjectHolder& rhs,
+                                runtime::Context& context) {
+                return runtime::Greater(lhs, rhs, context);
+            }
+        };
+
+        struct LessOrEqual {
+            template <typename T>
+            static bool Apply(const T& lhs, const T& rhs) {
+                return lhs <= rhs;
+            }
+
+            static bool Generic(const runtime::ObjectHolder& lhs, const runtime::ObjectHolder& rhs,
+                                runtime::Context& context) {
+                return runtime::LessOrEqual(lhs, rhs, context);
+            }
+        };
+
+        struct GreaterOrEqual {
+            template <typename T>
+            static bool Apply(const T& lhs, const T& rhs) {
+                return lhs >= rhs;
+            }
+
+            static bool Generic(const runtime::ObjectHolder& lhs, const runtime::ObjectHolder& rhs,
+                                runtime::Context& context) {
+                return runtime::GreaterOrEqual(lhs, rhs, context);
+            }
+        };
+    } // namespace compare
+
+    // Comparison node specialized for one operator: values of the same primitive type are
+    // compared in place, everything else goes to the generic runtime function (__eq__ / __lt__)
+    template <typename Cmp>
     class Comparison : public BinaryOperation {
     public:
-        using Comparator = std::function<bool(const runtime::ObjectHolder&,
-                                              const runtime::ObjectHolder&, runtime::Context&)>;
+        using BinaryOperation::BinaryOperation;
 
-        Comparison(Comparator cmp, std::unique_ptr<Statement> lhs, std::unique_ptr<Statement> rhs);
+        runtime::ObjectHolder Execute(runtime::Closure& closure, runtime::Context& context) override {
+            return BoolResult(ExecuteCondition(closure, context));
+        }
 
-        runtime::ObjectHolder Execute(runtime::Closure& closure, runtime::Context& context) override;
+        bool ExecuteCondition(runtime::Closure& closure, runtime::Context& context) override {
+            if (!rhs_ || !lhs_) {
+                throw std::runtime_error("null operands are not supported");
+            }
 
-    private:
-        Comparator cmp_;
+            auto l_obj = lhs_->Execute(closure, context);
+            auto r_obj = rhs_->Execute(closure, context);
+
+            if (auto l_ptr_n = l_obj.TryAs<runtime::Number>()) {
+                if (auto r_ptr_n = r_obj.TryAs<runtime::Number>()) {
+                    return Cmp::Apply(l_ptr_n->GetValue(), r_ptr_n->GetValue());
+                }
+            } else if (auto l_ptr_s = l_obj.TryAs<runtime::String>()) {
+                if (auto r_ptr_s = r_obj.TryAs<runtime::String>()) {
+                    return Cmp::Apply(*l_ptr_s, *r_ptr_s);
+                }
+            } else if (auto l_ptr_b = l_obj.TryAs<runtime::Bool>()) {
+                if (auto r_ptr_b = r_obj.TryAs<runtime::Bool>()) {
+                    return Cmp::Apply(l_ptr_b->GetValue(), r_ptr_b->GetValue());
+                }
+            }
+
+            return Cmp::Generic(l_obj, r_obj, context);
+        }
     };
 
+    using EqualComparison = Comparison<compare::Equal>;
+    using NotEqualComparison = Comparison<compare::NotEqual>;
+    using LessComparison = Comparison<compare::Less>;
+    using GreaterComparison = Comparison<compare::Greater>;
+    using LessOrEqualComparison = Comparison<compare::LessOrEqual>;
+    using GreaterOrEqualComparison = Comparison<compare::GreaterOrEqual>;
+
     class IfElse : public Statement {
     public:
         IfElse(std::unique_ptr<Statement> condition, std::unique_ptr<Statement> if_body,
                std::unique_ptr<Statement> else_body);
 
         runtime::ObjectHolder Execute(runtime::Closure& closure, runtime::Context& context) override;
+        void ForEachChild(const ChildVisitor& visitor) override;
+
+        Statement* GetCondition() const;
+        Statement* GetIfBody() const;
+        // null if there is no else branch
+        Statement* GetElseBody() const;
+
+        // Gives away the branch taken for the condition value, null if there is no else branch
+        std::unique_ptr<Statement> ReleaseBranch(bool condition);
 
     private:
         std::unique_ptr<Statement> condition_;
@@ -277,4 +619,359 @@ namespace ast {
         std::unique_ptr<Statement> else_body_;
     };
 
+    // while condition: body
+    class While : public Statement {
+    public:
+        While(std::unique_ptr<Statement> condition, std::unique_ptr<Statement> body);
+
+        runtime::ObjectHolder Execute(runtime::Closure& closure, runtime::Context& context) override;
+        void ForEachChild(const ChildVisitor& visitor) override;
+
+        Statement* GetCondition() const;
+        Statement* GetBody() const;
+
+    private:
+        std::unique_ptr<Statement> condition_;
+        std::unique_ptr<Statement> body_;
+    };
+
+    // break and continue don't unwind the stack, they set a loop signal in the context.
+    // Compound stops on a pending signal and the loop handles it
+    class Break : public Statement {
+    public:
+        runtime::ObjectHolder Execute(runtime::Closure& closure, runtime::Context& context) override;
+    };
+
+    class Continue : public Statement {
+    public:
+        runtime::ObjectHolder Execute(runtime::Closure& closure, runtime::Context& context) override;
+    };
+
+    // Superinstructions below are not produced by the parser, the optimizer (see optimize.h)
+    // fuses them from common statement patterns
+
+    // object.field = object.field + delta, the field slot is looked up once and a number is
+    // updated in place. Any other field value is handled by the original assignment
+    class FieldIncrement : public Statement {
+    public:
+        FieldIncrement(std::unique_ptr<FieldAssignment> original, std::int64_t delta);
+
+        runtime::ObjectHolder Execute(runtime::Closure& closure, runtime::Context& context) override;
+
+        const FieldAssignment& GetOriginal() const;
+
+    private:
+        VariableValue object_;
+        std::string field_name_;
+        std::int64_t delta_;
+        std::unique_ptr<FieldAssignment> original_;
+    };
+
+    // object.field = other.path
+    class FieldCopy : public Statement {
+    public:
+        FieldCopy(VariableValue object, std::string field_name, VariableValue source);
+
+        runtime::ObjectHolder Execute(runtime::Closure& closure, runtime::Context& context) override;
+
+        const std::string& GetFieldName() const;
+        const VariableValue& GetSource() const;
+
+    private:
+        VariableValue object_;
+        std::string field_name_;
+        VariableValue source_;
+    };
+
+    // self.method(constants...), the argument list is built once
+    class SelfMethodCall : public Statement {
+    public:
+        explicit SelfMethodCall(std::unique_ptr<MethodCall> original);
+
+        runtime::ObjectHolder Execute(runtime::Closure& closure, runtime::Context& context) override;
+
+        const MethodCache& GetCache() const;
+
+    private:
+        std::unique_ptr<MethodCall> original_;
+        std::vector<runtime::ObjectHolder> actual_args_;
+        MethodCache cache_;
+    };
+
+    // Call of a small method with its body substituted at the call site: self and the parameters
+    // are replaced by the receiver and argument expressions. The body is valid only for receivers
+    // of the class it was inlined for, the first receiver of another class deoptimizes the site
+    // back to the original call
+    class InlinedMethodCall : public Statement {
+    public:
+        InlinedMethodCall(std::unique_ptr<MethodCall> original, const runtime::Class& cls,
+                          std::unique_ptr<Statement> body, bool returns_value);
+
+        runtime::ObjectHolder Execute(runtime::Closure& closure, runtime::Context& context) override;
+        void ForEachChild(const ChildVisitor& visitor) override;
+
+        bool IsDeoptimized() const;
+
+    private:
+        std::unique_ptr<MethodCall> original_;
+        const runtime::Class& cls_;
+        std::unique_ptr<Statement> body_;
+        bool returns_value_;
+        bool deoptimized_ = false;
+    };
+
+    // Typed nodes below are produced by the type inference pass (see optimize::InferTypes) for
+    // expressions proven to be integers or strings. They work on native values and box the result
+    // once, when it leaves the typed subtree. Each typed root keeps the original expression: if a
+    // value turns out to have another type at run time, the original is executed instead.
+    // Typed subtrees are final, they don't expose children to later passes
+
+    // Thrown by typed nodes when a variable holds a value of unexpected type, or when a result
+    // overflows int64_t and has to be a BigNumber
+    class TypeGuardFailure : public std::exception {};
+
+    class IntExpression {
+    public:
+        virtual ~IntExpression() = default;
+
+        virtual std::int64_t Evaluate(runtime::Closure& closure, runtime::Context& context) const = 0;
+    };
+
+    class IntConst : public IntExpression {
+    public:
+        explicit IntConst(std::int64_t value);
+
+        std::int64_t Evaluate(runtime::Closure& closure, runtime::Context& context) const override;
+
+        std::int64_t GetValue() const;
+
+    private:
+        std::int64_t value_;
+    };
+
+    // Variable or field holding a number
+    class IntVariable : public IntExpression {
+    public:
+        explicit IntVariable(VariableValue var);
+
+        std::int64_t Evaluate(runtime::Closure& closure, runtime::Context& context) const override;
+
+    private:
+        mutable VariableValue var_;
+    };
+
+    namespace arithmetic {
+        struct Add {
+            static std::int64_t Apply(std::int64_t lhs, std::int64_t rhs) {
+                std::int64_t result;
+                if (__builtin_add_overflow(lhs, rhs, &result)) {
+                    throw TypeGuardFailure();
+                }
+                return result;
+            }
+        };
+
+        struct Sub {
+            static std::int64_t Apply(std::int64_t lhs, std::int64_t rhs) {
+                std::int64_t result;
+                if (__builtin_sub_overflow(lhs, rhs, &result)) {
+                    throw TypeGuardFailure();
+                }
+                return result;
+            }
+        };
+
+        struct Mult {
+            static std::int64_t Apply(std::int64_t lhs, std::int64_t rhs) {
+                std::int64_t result;
+                if (__builtin_mul_overflow(lhs, rhs, &result)) {
+                    throw TypeGuardFailure();
+                }
+                return result;
+            }
+        };
+
+        struct Div {
+            static std::int64_t Apply(std::int64_t lhs, std::int64_t rhs) {
+                if (rhs == 0) {
+                    throw std::runtime_error("division by zero");
+                }
+                if (lhs == INT64_MIN && rhs == -1) {
+                    throw TypeGuardFailure();
+                }
+                return lhs / rhs;
+            }
+        };
+    } // namespace arithmetic
+
+    template <typename Op>
+    class IntOperation : public IntExpression {
+    public:
+        IntOperation(std::unique_ptr<IntExpression> lhs, std::unique_ptr<IntExpression> rhs)
+            : lhs_(std::move(lhs))
+            , rhs_(std::move(rhs)) {
+        }
+
+        std::int64_t Evaluate(runtime::Closure& closure, runtime::Context& context) const override {
+            std::int64_t lhs = lhs_->Evaluate(closure, context);
+            return Op::Apply(lhs, rhs_->Evaluate(closure, context));
+        }
+
+        const IntExpression& GetLhs() const {
+            return *lhs_;
+        }
+
+        const IntExpression& GetRhs() const {
+            return *rhs_;
+        }
+
+    private:
+        std::unique_ptr<IntExpression> lhs_;
+        std::unique_ptr<IntExpression> rhs_;
+    };
+
+    // Machine code of an integer subtree, made by the JIT for hot methods (see jit::Jit). The
+    // interpreter reads the variables of the subtree in evaluation order and passes their values
+    // to the code, so a failing type guard is thrown before the code runs. The code itself never
+    // throws, it reports division by zero and overflow through error. Run throws TypeGuardFailure
+    // on overflow, so the original expression computes a BigNumber
+    struct CompiledInt {
+        static constexpr size_t MAX_INPUTS = 16;
+
+        // values of error
+        static constexpr int ERROR_NONE = 0;
+        static constexpr int ERROR_DIVISION_BY_ZERO = 1;
+        static constexpr int ERROR_OVERFLOW = 2;
+
+        using Function = std::int64_t (*)(const std::int64_t* inputs, int* error);
+
+        Function function = nullptr;
+        std::vector<const IntVariable*> inputs;
+        // keeps the executable memory of function
+        std::shared_ptr<const void> code;
+        // differential mode: every result is checked against the interpreter
+        bool verify = false;
+
+        std::int64_t Run(runtime::Closure& closure, runtime::Context& context) const;
+    };
+
+    // Thrown in the differential mode of the JIT when compiled code and the interpreter disagree
+    class CompiledCodeMismatch : public std::logic_error {
+    public:
+        using std::logic_error::logic_error;
+    };
+
+    // Root of an integer subtree, boxes the result into a Number
+    class UnboxedInt : public Statement, public ReusableResult {
+    public:
+        UnboxedInt(std::unique_ptr<IntExpression> expression, std::unique_ptr<Statement> original);
+
+        runtime::ObjectHolder Execute(runtime::Closure& closure, runtime::Context& context) override;
+
+        const IntExpression& GetExpression() const;
+        void SetCompiled(CompiledInt compiled);
+
+    private:
+        std::unique_ptr<IntExpression> expression_;
+        std::unique_ptr<Statement> original_;
+        CompiledInt compiled_;
+    };
+
+    // Comparison of two integer subtrees
+    template <typename Cmp>
+    class UnboxedComparison : public Statement, public ReusableResult {
+    public:
+        UnboxedComparison(std::unique_ptr<IntExpression> lhs, std::unique_ptr<IntExpression> rhs,
+                          std::unique_ptr<Statement> original)
+            : lhs_(std::move(lhs))
+            , rhs_(std::move(rhs))
+            , original_(std::move(original)) {
+        }
+
+        runtime::ObjectHolder Execute(runtime::Closure& closure, runtime::Context& context) override {
+            return BoolResult(ExecuteCondition(closure, context));
+        }
+
+        bool ExecuteCondition(runtime::Closure& closure, runtime::Context& context) override {
+            if (compiled_.function != nullptr) {
+                return ExecuteCompiled(closure, context);
+            }
+
+            std::int64_t lhs;
+            std::int64_t rhs;
+
+            try {
+                lhs = lhs_->Evaluate(closure, context);
+                rhs = rhs_->Evaluate(closure, context);
+            } catch (const TypeGuardFailure&) {
+                return original_->ExecuteCondition(closure, context);
+            }
+
+            return Cmp::Apply(lhs, rhs);
+        }
+
+        const IntExpression& GetLhs() const {
+            return *lhs_;
+        }
+
+        const IntExpression& GetRhs() const {
+            return *rhs_;
+        }
+
+        // The compiled code computes both sides and compares them
+        void SetCompiled(CompiledInt compiled) {
+            compiled_ = std::move(compiled);
+        }
+
+    private:
+        bool ExecuteCompiled(runtime::Closure& closure, runtime::Context& context) {
+            bool result;
+
+            try {
+                result = compiled_.Run(closure, context) != 0;
+            } catch (const TypeGuardFailure&) {
+                return original_->ExecuteCondition(closure, context);
+            }
+
+            if (compiled_.verify) {
+                bool expected;
+
+                try {
+                    expected = Cmp::Apply(lhs_->Evaluate(closure, context), rhs_->Evaluate(closure, context));
+                } catch (const TypeGuardFailure&) {
+                    throw CompiledCodeMismatch("compiled comparison passed a guard the interpreter failed");
+                }
+
+                if (result != expected) {
+                    throw CompiledCodeMismatch("compiled comparison differs from the interpreter");
+                }
+            }
+
+            return result;
+        }
+
+        std::unique_ptr<IntExpression> lhs_;
+        std::unique_ptr<IntExpression> rhs_;
+        std::unique_ptr<Statement> original_;
+        CompiledInt compiled_;
+    };
+
+    // Chain of string additions, parts are appended to one buffer. A part is a string constant,
+    // a variable holding a string, or str() of a variable holding a number, a string or a bool
+    class StringConcat : public Statement, public ReusableResult {
+    public:
+        struct Part {
+            std::unique_ptr<Statement> value;
+            bool stringify = false;
+        };
+
+        StringConcat(std::vector<Part> parts, std::unique_ptr<Statement> original);
+
+        runtime::ObjectHolder Execute(runtime::Closure& closure, runtime::Context& context) override;
+
+    private:
+        std::vector<Part> parts_;
+        std::unique_ptr<Statement> original_;
+    };
+
 } // namespace ast
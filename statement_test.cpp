@@ -470,6 +470,63 @@ namespace ast {
             test_not(false);
         }
 
+        void TestComparisons() {
+            auto compare = [](unique_ptr<Statement> statement) {
+                Closure closure;
+                runtime::DummyContext context;
+                return runtime::IsTrue(statement->Execute(closure, context));
+            };
+
+            ASSERT(compare(make_unique<LessComparison>(make_unique<NumericConst>(1), make_unique<NumericConst>(2))));
+            ASSERT(!compare(make_unique<GreaterComparison>(make_unique<NumericConst>(1), make_unique<NumericConst>(2))));
+            ASSERT(compare(make_unique<EqualComparison>(make_unique<StringConst>("abc"s), make_unique<StringConst>("abc"s))));
+            ASSERT(compare(make_unique<NotEqualComparison>(make_unique<StringConst>("abc"s), make_unique<StringConst>("abd"s))));
+            ASSERT(compare(make_unique<LessOrEqualComparison>(make_unique<BoolConst>(false), make_unique<BoolConst>(true))));
+            ASSERT(compare(make_unique<GreaterOrEqualComparison>(make_unique<NumericConst>(2), make_unique<NumericConst>(2))));
+            ASSERT(compare(make_unique<EqualComparison>(make_unique<None>(), make_unique<None>())));
+
+            ASSERT_THROWS(compare(make_unique<LessComparison>(make_unique<NumericConst>(1), make_unique<StringConst>("1"s))),
+                          std::runtime_error);
+        }
+
+        void TestMethodCallCache() {
+            runtime::DummyContext context;
+
+            vector<runtime::Method> methods;
+            methods.push_back({ "get"s, {}, make_unique<MethodBody>(make_unique<Return>(make_unique<NumericConst>(1))) });
+            runtime::Class base("Base"s, std::move(methods), nullptr);
+
+            methods.clear();
+            methods.push_back({ "get"s, {}, make_unique<MethodBody>(make_unique<Return>(make_unique<NumericConst>(2))) });
+            runtime::Class child("Child"s, std::move(methods), &base);
+
+            runtime::Class other("Other"s, {}, nullptr);
+
+            runtime::ClassInstance base_inst(base);
+            runtime::ClassInstance child_inst(child);
+            runtime::ClassInstance other_inst(other);
+
+            MethodCall call(make_unique<VariableValue>("x"s), "get"s, {});
+
+            Closure closure = { { "x"s, ObjectHolder::Share(base_inst) } };
+            for (int i = 0; i < 3; ++i) {
+                ASSERT_OBJECT_VALUE_EQUAL(call.Execute(closure, context), 1);
+            }
+            ASSERT_EQUAL(call.GetCache().GetStats().misses, 1U);
+            ASSERT_EQUAL(call.GetCache().GetStats().hits, 2U);
+
+            closure["x"s] = ObjectHolder::Share(child_inst);
+            ASSERT_OBJECT_VALUE_EQUAL(call.Execute(closure, context), 2);
+            closure["x"s] = ObjectHolder::Share(base_inst);
+            ASSERT_OBJECT_VALUE_EQUAL(call.Execute(closure, context), 1);
+            ASSERT_EQUAL(call.GetCache().GetStats().misses, 2U);
+            ASSERT_EQUAL(call.GetCache().GetStats().hits, 3U);
+            ASSERT(!call.GetCache().IsMegamorphic());
+
+            closure["x"s] = ObjectHolder::Share(other_inst);
+            ASSERT_THROWS(call.Execute(closure, context), std::runtime_error);
+        }
+
         void RunMythonProgram(istream& input, ostream& output) {
             parse::Lexer lexer(input);
             auto program = ParseProgram(lexer);
@@ -524,6 +581,66 @@ print x, y
             ASSERT_EQUAL(output.str(), "15 120 -13 3 15\n");
         }
 
+        void TestIntegerOverflow() {
+            istringstream input(R"(
+x = 9223372036854775807
+print x + 1, x * x, 0 - x - 1 - 1
+y = x + 1
+print y - 1, y / 2, (0 - y) / (0 - 1)
+print y > x, y == x + 1, x < y, y == 5
+f = 1
+i = 1
+while i <= 25:
+  f = f * i
+  i = i + 1
+print f, f / f, 3000000000 * 3
+)");
+
+            ostringstream output;
+            RunMythonProgram(input, output);
+
+            ASSERT_EQUAL(output.str(),
+                         "9223372036854775808 85070591730234615847396907784232501249 -9223372036854775809\n"
+                         "9223372036854775807 4611686018427387904 9223372036854775808\n"
+                         "True True True False\n"
+                         "15511210043330985984000000 1 9000000000\n"s);
+
+            istringstream too_long("print 99999999999999999999");
+            ostringstream unused;
+            ASSERT_THROWS(RunMythonProgram(too_long, unused), parse::LexerError);
+        }
+
+        void TestPrintConcatenation() {
+            istringstream input(R"(
+class Loud:
+  def __str__():
+    print 'str called'
+    return 'loud'
+
+class Prefix:
+  def __add__(s):
+    return '>' + s
+
+x = 'middle'
+print 'a' + x + 'b' + str(1 + 2) + str(True) + str(None), 1 + 2
+print 'before ' + str(Loud()) + ' after'
+p = Prefix()
+print p + x + '!', str(x) + str(x)
+)");
+
+            ostringstream output;
+            RunMythonProgram(input, output);
+
+            ASSERT_EQUAL(output.str(),
+                         "amiddleb3TrueNone 3\nbefore str called\nloud after\n>middle! middlemiddle\n");
+
+            // pieces are written only when the whole argument is evaluated
+            istringstream bad_input("print 'x', 'a' + str(1) + 2");
+            ostringstream bad_output;
+            ASSERT_THROWS(RunMythonProgram(bad_input, bad_output), std::runtime_error);
+            ASSERT_EQUAL(bad_output.str(), "x "s);
+        }
+
         void TestVariablesArePointers() {
             istringstream input(R"(
 class Counter:
@@ -556,6 +673,79 @@ print y.value
 
             ASSERT_EQUAL(output.str(), "2\n3\n");
         }
+
+        void TestNewInstanceIsFresh() {
+            istringstream input(R"(
+class Point:
+  def __init__(x):
+    self.x = x
+
+class Factory:
+  def make(x):
+    return Point(x)
+
+f = Factory()
+a = f.make(1)
+b = f.make(2)
+print a.x, b.x
+a.x = 3
+print a.x, b.x
+)");
+
+            ostringstream output;
+            RunMythonProgram(input, output);
+
+            ASSERT_EQUAL(output.str(), "1 2\n3 2\n");
+        }
+
+        // collections before every new instance free the dropped cycles and keep the reachable ones
+        void TestCyclesAreCollected() {
+            istringstream input(R"(
+class Node:
+  def __init__(value):
+    self.value = value
+    self.me = self
+    self.next = None
+
+  def link(other):
+    self.next = other
+    other.next = self
+    return self
+
+class Ring:
+  def make(value):
+    node = Node(value)
+    return node.link(Node(value + 1))
+
+r = Ring()
+kept = r.make(0)
+i = 0
+while i < 20:
+  dropped = r.make(i)
+  i = i + 1
+print kept.value, kept.next.value, kept.next.next.me.value, dropped.next.value
+)");
+
+            parse::Lexer lexer(input);
+            auto program = ParseProgram(lexer);
+
+            runtime::GarbageCollector::Config config;
+            config.stress = true;
+            runtime::GarbageCollector collector(config);
+
+            ostringstream output;
+            runtime::SimpleContext context{ output };
+            runtime::Closure closure;
+            program->Execute(closure, context);
+
+            ASSERT_EQUAL(output.str(), "0 1 0 20\n"s);
+            ASSERT(collector.GetStats().freed > 0U);
+
+            // r, kept and dropped with their links are left
+            collector.Collect(true);
+            ASSERT_EQUAL(collector.GetStats().freed, 38U);
+            ASSERT_EQUAL(collector.GetTracked(), 5U);
+        }
     } // namespace
 
     void RunUnitTests(TestRunner& tr) {
@@ -579,10 +769,16 @@ print y.value
         RUN_TEST(tr, ast::TestOr);
         RUN_TEST(tr, ast::TestAnd);
         RUN_TEST(tr, ast::TestNot);
+        RUN_TEST(tr, ast::TestComparisons);
+        RUN_TEST(tr, ast::TestMethodCallCache);
         RUN_TEST(tr, ast::TestSimplePrints);
         RUN_TEST(tr, ast::TestAssignments);
         RUN_TEST(tr, ast::TestArithmetics);
+        RUN_TEST(tr, ast::TestIntegerOverflow);
+        RUN_TEST(tr, ast::TestPrintConcatenation);
         RUN_TEST(tr, ast::TestVariablesArePointers);
+        RUN_TEST(tr, ast::TestNewInstanceIsFresh);
+        RUN_TEST(tr, ast::TestCyclesAreCollected);
     }
 
 } // namespace ast
\ No newline at end of file
@@ -0,0 +1,558 @@
+#include "transpile.h"
+
+#include "statement.h"
+
+#include <map>
+#include <set>
+#include <sstream>
+#include <typeinfo>
+#include <unordered_map>
+
+using namespace std;
+
+namespace transpile {
+
+    namespace {
+        using ast::Statement;
+
+        const string SELF_OBJECT = "self"s;
+
+        // C++ literal of the text
+        string Quote(const string& text) {
+            string result = "\""s;
+
+            for (char c : text) {
+                switch (c) {
+                case '"':
+                    result += "\\\""s;
+                    break;
+                case '\\':
+                    result += "\\\\"s;
+                    break;
+                case '\n':
+                    result += "\\n"s;
+                    break;
+                case '\t':
+                    result += "\\t"s;
+                    break;
+                case '\r':
+                    result += "\\r"s;
+                    break;
+                default:
+                    if (static_cast<unsigned char>(c) < 0x20) {
+                        // three octal digits, a shorter escape could take the next char
+                        result += '\\';
+                        result += static_cast<char>('0' + ((c >> 6) & 7));
+                        result += static_cast<char>('0' + ((c >> 3) & 7));
+                        result += static_cast<char>('0' + (c & 7));
+                    } else {
+                        result += c;
+                    }
+                }
+            }
+
+            return result + "\""s;
+        }
+
+        // C++ literal of the number, the minimum value has no literal of its own
+        string IntLiteral(std::int64_t value) {
+            if (value == INT64_MIN) {
+                return "(-9223372036854775807 - 1)"s;
+            }
+            return to_string(value);
+        }
+
+        runtime::Executable::ChildVisitor ClassCollector(vector<ast::ClassDefinition*>& classes) {
+            return [&classes](unique_ptr<Statement>& node) {
+                if (auto* definition = dynamic_cast<ast::ClassDefinition*>(node.get())) {
+                    classes.push_back(definition);
+                    return;
+                }
+                node->ForEachChild(ClassCollector(classes));
+            };
+        }
+
+        // Writes code of functions into a buffer and collects the names, constants and call sites
+        // they use, which are declared at the top of the translation unit
+        class CppEmitter {
+        public:
+            void EmitProgram(unique_ptr<Statement>& program, ostream& output) {
+                vector<ast::ClassDefinition*> classes;
+                ClassCollector(classes)(program);
+
+                for (const auto* definition : classes) {
+                    const auto& cls = definition->GetClass();
+                    class_structs_[&cls] = "Class_"s + cls.GetName();
+                }
+
+                for (const auto* definition : classes) {
+                    EmitClass(definition->GetClass());
+                }
+
+                Function run_program;
+                function_ = &run_program;
+                EmitStatement(*program);
+                EmitFunctionDefinition("void RunProgram(Context& context)"s, run_program, false);
+
+                WriteTranslationUnit(classes, output);
+            }
+
+        private:
+            // Function being emitted
+            struct Function {
+                ostringstream code;
+                // self and parameters bound from the method closure
+                vector<string> parameters;
+                // other variables in order of appearance
+                vector<string> locals;
+                set<string> known;
+                size_t temporaries = 0;
+                int indent = 2;
+                bool is_method = false;
+            };
+
+            [[noreturn]] static void Unsupported(const Statement& node) {
+                throw std::runtime_error("--emit-cpp doesn't support nodes of type "s + typeid(node).name());
+            }
+
+            void Line(const string& text) {
+                function_->code << string(4 * function_->indent, ' ') << text << '\n';
+            }
+
+            string Temporary() {
+                return "t"s + to_string(++function_->temporaries);
+            }
+
+            // Declares a temporary holding the value
+            string Value(const string& expression) {
+                string name = Temporary();
+                Line("runtime::ObjectHolder "s + name + " = "s + expression + ";"s);
+                return name;
+            }
+
+            string Condition(const string& expression) {
+                string name = Temporary();
+                Line("bool "s + name + " = "s + expression + ";"s);
+                return name;
+            }
+
+            // Global std::string with the text
+            string Name(const string& text) {
+                auto [it, inserted] = names_.emplace(text, names_.size());
+                return "NAME_"s + to_string(it->second);
+            }
+
+            // Global holder made by the initializer once
+            string Constant(const string& initializer) {
+                auto [it, inserted] = constants_.emplace(initializer, constants_.size());
+                if (inserted) {
+                    constant_order_.push_back(initializer);
+                }
+                return "CONST_"s + to_string(it->second);
+            }
+
+            string Variable(const string& name) {
+                if (function_->known.insert(name).second) {
+                    function_->locals.push_back(name);
+                }
+                return "v_"s + name;
+            }
+
+            void EmitClass(const runtime::Class& cls) {
+                const string& struct_name = class_structs_.at(&cls);
+                set<string> function_names;
+
+                for (const auto& method : cls.Methods()) {
+                    auto* body = dynamic_cast<ast::MethodBody*>(method.body.get());
+                    if (body == nullptr) {
+                        throw std::runtime_error("--emit-cpp needs the body of method "s + cls.GetName() + "."s
+                                                 + method.name);
+                    }
+
+                    // methods with the same name differ in parameters count
+                    string function_name = "Method_"s + method.name;
+                    if (!function_names.insert(function_name).second) {
+                        function_name += "_"s + to_string(method.formal_params.size());
+                    }
+
+                    Function function;
+                    function.is_method = true;
+                    // a parameter named self replaces the receiver in the closure
+                    function.parameters.push_back(SELF_OBJECT);
+                    for (const auto& param : method.formal_params) {
+                        if (param != SELF_OBJECT) {
+                            function.parameters.push_back(param);
+                        }
+                    }
+                    function.known.insert(function.parameters.begin(), function.parameters.end());
+
+                    function_ = &function;
+                    EmitStatement(*body->GetBody());
+
+                    EmitFunctionDefinition("runtime::ObjectHolder "s + struct_name + "::"s + function_name
+                                               + "(Closure& closure, Context& context)"s,
+                                           function, true);
+
+                    methods_[&cls].push_back({ &method, function_name });
+                }
+            }
+
+            void EmitFunctionDefinition(const string& signature, Function& function, bool returns_value) {
+                definitions_ << "    "sv << signature << " {\n"sv;
+
+                for (const auto& parameter : function.parameters) {
+                    definitions_ << "        aot::Variable v_"sv << parameter << "(closure, "sv << Name(parameter)
+                                 << ");\n"sv;
+                }
+                for (const auto& local : function.locals) {
+                    definitions_ << "        aot::Variable v_"sv << local << ";\n"sv;
+                }
+                if (!function.parameters.empty() || !function.locals.empty()) {
+                    definitions_ << '\n';
+                }
+
+                definitions_ << function.code.str();
+
+                if (returns_value) {
+                    definitions_ << "        return {};\n"sv;
+                }
+                definitions_ << "    }\n\n"sv;
+            }
+
+            // Value of the dotted path, the first id is a variable
+            string EmitPath(const ast::VariableValue& path) {
+                const auto& ids = path.GetDottedIds();
+
+                string current = Temporary();
+                Line("const runtime::ObjectHolder& "s + current + " = "s + Variable(ids.front()) + ".Get();"s);
+
+                for (size_t i = 1; i < ids.size(); ++i) {
+                    current = Value("aot::ReadField("s + current + ", "s + Name(ids[i]) + ")"s);
+                }
+
+                return current;
+            }
+
+            // Arguments evaluated one by one, as an initializer list
+            string EmitArgs(const vector<unique_ptr<Statement>>& args) {
+                string result = "{"s;
+
+                for (const auto& arg : args) {
+                    result += (arg == args.front() ? " "s : ", "s) + EmitValue(*arg);
+                }
+
+                return result + (args.empty() ? "}"s : " }"s);
+            }
+
+            template <typename Node>
+            bool TryArithmetic(Statement& node, const char* function, bool with_context, string& result) {
+                auto* operation = dynamic_cast<Node*>(&node);
+                if (operation == nullptr) {
+                    return false;
+                }
+
+                string lhs = EmitValue(*operation->GetLhs());
+                string rhs = EmitValue(*operation->GetRhs());
+                result = Value(function + "("s + lhs + ", "s + rhs + (with_context ? ", context)"s : ")"s));
+
+                return true;
+            }
+
+            template <typename Cmp>
+            bool TryComparison(Statement& node, const char* function, string& result) {
+                auto* comparison = dynamic_cast<ast::Comparison<Cmp>*>(&node);
+                if (comparison == nullptr) {
+                    return false;
+                }
+
+                string lhs = EmitValue(*comparison->GetLhs());
+                string rhs = EmitValue(*comparison->GetRhs());
+                result = Condition(function + "("s + lhs + ", "s + rhs + ", context)"s);
+
+                return true;
+            }
+
+            bool IsCondition(Statement& node) {
+                return dynamic_cast<ast::Or*>(&node) != nullptr || dynamic_cast<ast::And*>(&node) != nullptr
+                       || dynamic_cast<ast::Not*>(&node) != nullptr
+                       || dynamic_cast<ast::Comparison<ast::compare::Equal>*>(&node) != nullptr
+                       || dynamic_cast<ast::Comparison<ast::compare::NotEqual>*>(&node) != nullptr
+                       || dynamic_cast<ast::Comparison<ast::compare::Less>*>(&node) != nullptr
+                       || dynamic_cast<ast::Comparison<ast::compare::Greater>*>(&node) != nullptr
+                       || dynamic_cast<ast::Comparison<ast::compare::LessOrEqual>*>(&node) != nullptr
+                       || dynamic_cast<ast::Comparison<ast::compare::GreaterOrEqual>*>(&node) != nullptr;
+            }
+
+            // Name of a bool. Both operands of and / or are evaluated, as in the interpreter
+            string EmitCondition(Statement& node) {
+                string result;
+
+                if (auto* operation = dynamic_cast<ast::Or*>(&node)) {
+                    string lhs = EmitCondition(*operation->GetLhs());
+                    string rhs = EmitCondition(*operation->GetRhs());
+                    return Condition(lhs + " || "s + rhs);
+                }
+                if (auto* operation = dynamic_cast<ast::And*>(&node)) {
+                    string lhs = EmitCondition(*operation->GetLhs());
+                    string rhs = EmitCondition(*operation->GetRhs());
+                    return Condition(lhs + " && "s + rhs);
+                }
+                if (auto* operation = dynamic_cast<ast::Not*>(&node)) {
+                    return Condition("!"s + EmitCondition(*operation->GetArgument()));
+                }
+                if (TryComparison<ast::compare::Equal>(node, "runtime::Equal", result)
+                    || TryComparison<ast::compare::NotEqual>(node, "runtime::NotEqual", result)
+                    || TryComparison<ast::compare::Less>(node, "runtime::Less", result)
+                    || TryComparison<ast::compare::Greater>(node, "runtime::Greater", result)
+                    || TryComparison<ast::compare::LessOrEqual>(node, "runtime::LessOrEqual", result)
+                    || TryComparison<ast::compare::GreaterOrEqual>(node, "runtime::GreaterOrEqual", result)) {
+                    return result;
+                }
+
+                return Condition("runtime::IsTrue("s + EmitValue(node) + ")"s);
+            }
+
+            // Expression of the value, a temporary unless the value is a constant
+            string EmitValue(Statement& node) {
+                string result;
+
+                if (auto* constant = dynamic_cast<ast::NumericConst*>(&node)) {
+                    return Constant("aot::MakeNumber("s + IntLiteral(constant->GetValue().GetValue()) + ")"s);
+                }
+                if (auto* constant = dynamic_cast<ast::StringConst*>(&node)) {
+                    return Constant("runtime::String::Intern("s + Quote(constant->GetValue().GetValue()) + ")"s);
+                }
+                if (auto* constant = dynamic_cast<ast::BoolConst*>(&node)) {
+                    return Constant(constant->GetValue().GetValue() ? "aot::MakeBool(true)"s : "aot::MakeBool(false)"s);
+                }
+                if (dynamic_cast<ast::None*>(&node) != nullptr) {
+                    return "runtime::ObjectHolder()"s;
+                }
+                if (auto* variable = dynamic_cast<ast::VariableValue*>(&node)) {
+                    return EmitPath(*variable);
+                }
+                if (IsCondition(node)) {
+                    return Value("aot::MakeBool("s + EmitCondition(node) + ")"s);
+                }
+                if (TryArithmetic<ast::Add>(node, "aot::Add", true, result)
+                    || TryArithmetic<ast::Sub>(node, "aot::Sub", false, result)
+                    || TryArithmetic<ast::Mult>(node, "aot::Mult", false, result)
+                    || TryArithmetic<ast::Div>(node, "aot::Div", false, result)) {
+                    return result;
+                }
+                if (auto* stringify = dynamic_cast<ast::Stringify*>(&node)) {
+                    return Value("aot::Stringify("s + EmitValue(*stringify->GetArgument()) + ", context)"s);
+                }
+                if (auto* call = dynamic_cast<ast::MethodCall*>(&node)) {
+                    return EmitMethodCall(*call);
+                }
+                if (auto* new_instance = dynamic_cast<ast::NewInstance*>(&node)) {
+                    const string& struct_name = class_structs_.at(&new_instance->GetClass());
+                    string args = EmitArgs(new_instance->GetArgs());
+
+                    return Value("aot::NewInstance(aot::AsClass("s + struct_name + "::object), "s + args + ", context)"s);
+                }
+
+                Unsupported(node);
+            }
+
+            string EmitMethodCall(ast::MethodCall& call) {
+                const string& method = call.GetMethodName();
+
+                string object = EmitValue(*call.GetObject());
+                string receiver = Temporary();
+                Line("runtime::ClassInstance& "s + receiver + " = aot::Receiver("s + object + ", "s + Name(method)
+                     + ");"s);
+
+                string args = EmitArgs(call.GetArgs());
+                string site = "CALL_"s + to_string(call_sites_.size());
+                call_sites_.push_back(Name(method));
+
+                return Value(site + ".Call("s + receiver + ", "s + args + ", context)"s);
+            }
+
+            void EmitPrint(ast::Print& print) {
+                Line("{"s);
+                ++function_->indent;
+                Line("std::ostream& os = context.GetOutputStream();"s);
+
+                const auto& args = print.GetArgs();
+                for (const auto& arg : args) {
+                    if (arg != args.front()) {
+                        Line("os << ' ';"s);
+                    }
+                    Line("aot::PrintValue(os, "s + EmitValue(*arg) + ", context);"s);
+                }
+                Line("os << '\\n';"s);
+
+                --function_->indent;
+                Line("}"s);
+            }
+
+            void EmitBlock(Statement& body) {
+                ++function_->indent;
+                EmitStatement(body);
+                --function_->indent;
+            }
+
+            void EmitStatement(Statement& node) {
+                if (auto* compound = dynamic_cast<ast::Compound*>(&node)) {
+                    for (auto& statement : compound->Statements()) {
+                        EmitStatement(*statement);
+                    }
+                } else if (auto* assignment = dynamic_cast<ast::Assignment*>(&node)) {
+                    string value = EmitValue(*assignment->rv_);
+                    Line(Variable(assignment->var_) + ".Set("s + value + ");"s);
+                } else if (auto* assignment = dynamic_cast<ast::FieldAssignment*>(&node)) {
+                    string object = EmitPath(assignment->GetObject());
+                    string value = EmitValue(*assignment->GetRv());
+                    Line("aot::AssignField("s + object + ", "s + Name(assignment->GetFieldName()) + ", "s + value
+                         + ");"s);
+                } else if (auto* print = dynamic_cast<ast::Print*>(&node)) {
+                    EmitPrint(*print);
+                } else if (auto* if_else = dynamic_cast<ast::IfElse*>(&node)) {
+                    Line("if ("s + EmitCondition(*if_else->GetCondition()) + ") {"s);
+                    EmitBlock(*if_else->GetIfBody());
+                    if (if_else->GetElseBody() != nullptr) {
+                        Line("} else {"s);
+                        EmitBlock(*if_else->GetElseBody());
+                    }
+                    Line("}"s);
+                } else if (auto* loop = dynamic_cast<ast::While*>(&node)) {
+                    // the condition is evaluated inside, so that continue evaluates it again
+                    Line("while (true) {"s);
+                    ++function_->indent;
+                    Line("if (!"s + EmitCondition(*loop->GetCondition()) + ") {"s);
+                    Line("    break;"s);
+                    Line("}"s);
+                    EmitStatement(*loop->GetBody());
+                    --function_->indent;
+                    Line("}"s);
+                } else if (dynamic_cast<ast::Break*>(&node) != nullptr) {
+                    Line("break;"s);
+                } else if (dynamic_cast<ast::Continue*>(&node) != nullptr) {
+                    Line("continue;"s);
+                } else if (auto* statement = dynamic_cast<ast::Return*>(&node)) {
+                    if (!function_->is_method) {
+                        throw std::runtime_error("--emit-cpp doesn't support return outside of a method"s);
+                    }
+                    Line("return "s + EmitValue(*statement->GetStatement()) + ";"s);
+                } else if (auto* definition = dynamic_cast<ast::ClassDefinition*>(&node)) {
+                    const auto& cls = definition->GetClass();
+                    Line(Variable(cls.GetName()) + ".Set("s + class_structs_.at(&cls) + "::object);"s);
+                } else {
+                    // expression statement, the value is dropped
+                    EmitValue(node);
+                }
+            }
+
+            void WriteTranslationUnit(const vector<ast::ClassDefinition*>& classes, ostream& output) {
+                for (const auto* definition : classes) {
+                    Name(definition->GetClass().GetName());
+                    for (const auto& method : definition->GetClass().Methods()) {
+                        Name(method.name);
+                        for (const auto& param : method.formal_params) {
+                            Name(param);
+                        }
+                    }
+                }
+
+                output << "// Generated by mython --emit-cpp. Build together with the mython runtime:\n"sv
+                       << "//     c++ -std=c++17 -O2 -I<mython> program.cpp <mython>/aot.cpp <mython>/runtime.cpp <mython>/bigint.cpp\n"sv
+                       << "#include \"aot.h\"\n\n"sv
+                       << "#include <ostream>\n#include <string>\n#include <vector>\n\n"sv
+                       << "namespace {\n"sv
+                       << "    using runtime::Closure;\n"sv
+                       << "    using runtime::Context;\n"sv
+                       << "    using runtime::ObjectHolder;\n\n"sv;
+
+                vector<const string*> names(names_.size());
+                for (const auto& [text, index] : names_) {
+                    names[index] = &text;
+                }
+                for (size_t i = 0; i < names.size(); ++i) {
+                    output << "    const std::string NAME_"sv << i << " = "sv << Quote(*names[i]) << ";\n"sv;
+                }
+                if (!names.empty()) {
+                    output << '\n';
+                }
+
+                for (size_t i = 0; i < constant_order_.size(); ++i) {
+                    output << "    const ObjectHolder CONST_"sv << i << " = "sv << constant_order_[i] << ";\n"sv;
+                }
+                for (size_t i = 0; i < call_sites_.size(); ++i) {
+                    output << "    aot::CallSite CALL_"sv << i << "{ "sv << call_sites_[i] << " };\n"sv;
+                }
+                output << '\n';
+
+                for (const auto* definition : classes) {
+                    const auto& cls = definition->GetClass();
+
+                    output << "    struct "sv << class_structs_.at(&cls) << " {\n"sv
+                           << "        inline static ObjectHolder object;\n\n"sv
+                           << "        static void Define();\n\n"sv;
+                    for (const auto& [method, function_name] : methods_[&cls]) {
+                        output << "        static ObjectHolder "sv << function_name
+                               << "(Closure& closure, Context& context);\n"sv;
+                    }
+                    output << "    };\n\n"sv;
+                }
+
+                for (const auto* definition : classes) {
+                    const auto& cls = definition->GetClass();
+                    const string& struct_name = class_structs_.at(&cls);
+
+                    output << "    void "sv << struct_name << "::Define() {\n"sv
+                           << "        std::vector<runtime::Method> methods;\n"sv;
+
+                    for (const auto& [method, function_name] : methods_[&cls]) {
+                        string params = "{"s;
+                        for (const auto& param : method->formal_params) {
+                            params += (param == method->formal_params.front() ? " "s : ", "s) + Name(param);
+                        }
+                        params += method->formal_params.empty() ? "}"s : " }"s;
+
+                        output << "        methods.push_back(aot::MakeMethod("sv << Name(method->name) << ", "sv
+                               << params << ", &"sv << function_name << ", "sv << (method->pure ? "true"sv : "false"sv)
+                               << "));\n"sv;
+                    }
+
+                    const runtime::Class* parent = cls.GetParent();
+                    output << "        object = ObjectHolder::Own(runtime::Class("sv << Name(cls.GetName())
+                           << ", std::move(methods), "sv
+                           << (parent == nullptr ? "nullptr"s : "&aot::AsClass("s + class_structs_.at(parent) + "::object)"s)
+                           << "));\n"sv
+                           << "    }\n\n"sv;
+                }
+
+                output << definitions_.str() << "} // namespace\n\n"sv
+                       << "int main() {\n"sv;
+                for (const auto* definition : classes) {
+                    output << "    "sv << class_structs_.at(&definition->GetClass()) << "::Define();\n"sv;
+                }
+                if (!classes.empty()) {
+                    output << '\n';
+                }
+                output << "    return aot::Run(&RunProgram);\n"sv
+                       << "}\n"sv;
+            }
+
+            Function* function_ = nullptr;
+            ostringstream definitions_;
+
+            unordered_map<const runtime::Class*, string> class_structs_;
+            unordered_map<const runtime::Class*, vector<pair<const runtime::Method*, string>>> methods_;
+
+            map<string, size_t> names_;
+            map<string, size_t> constants_;
+            vector<string> constant_order_;
+            // name of the method called at each site
+            vector<string> call_sites_;
+        };
+    } // namespace
+
+    void EmitCpp(unique_ptr<runtime::Executable>& program, ostream& output) {
+        CppEmitter().EmitProgram(program, output);
+    }
+
+} // namespace transpile
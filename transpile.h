@@ -0,0 +1,19 @@
+#pragma once
+
+#include <iosfwd>
+#include <memory>
+
+namespace runtime {
+    class Executable;
+}
+
+namespace transpile {
+
+    // Writes a C++ translation unit running the parsed program, to be compiled with aot.cpp,
+    // runtime.cpp and bigint.cpp (see aot.h). Every class becomes a struct with a static function per method,
+    // variables become C++ locals, expressions are evaluated into temporaries in the order of the
+    // interpreter. Only nodes made by the parser are supported: trees changed by optimization
+    // passes other than optimize::MarkPureMethods make EmitCpp throw std::runtime_error
+    void EmitCpp(std::unique_ptr<runtime::Executable>& program, std::ostream& output);
+
+} // namespace transpile
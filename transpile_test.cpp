@@ -0,0 +1,123 @@
+#include "lexer.h"
+#include "optimize.h"
+#include "parse.h"
+#include "statement.h"
+#include "test_runner_p.h"
+#include "transpile.h"
+
+using namespace std;
+
+namespace transpile {
+
+    namespace {
+        unique_ptr<ast::Statement> ParseProgramFromString(const string& program) {
+            istringstream is(program);
+            parse::Lexer lexer(is);
+
+            return ParseProgram(lexer);
+        }
+
+        string Emit(unique_ptr<ast::Statement>& program) {
+            ostringstream out;
+            EmitCpp(program, out);
+
+            return out.str();
+        }
+
+        bool Contains(const string& text, const string& part) {
+            return text.find(part) != string::npos;
+        }
+
+        const string SHAPES = R"(
+class Shape:
+  def __init__(name):
+    self.name = name
+
+  def area():
+    return 0
+
+  def __str__():
+    return self.name + ' ' + str(self.area())
+
+class Rect(Shape):
+  def __init__(w, h):
+    self.name = 'rect'
+    self.w = w
+    self.h = h
+
+  def area():
+    return self.w * self.h
+
+r = Rect(2, 3)
+s = Shape('dot')
+print r, s, r.area() > s.area() or False
+)"s;
+
+        void TestEmitClasses() {
+            auto program = ParseProgramFromString(SHAPES);
+            optimize::MarkPureMethods(program);
+            const string code = Emit(program);
+
+            ASSERT(Contains(code, "#include \"aot.h\""s));
+            ASSERT(Contains(code, "struct Class_Shape {"s));
+            ASSERT(Contains(code, "struct Class_Rect {"s));
+            ASSERT(Contains(code, "static ObjectHolder Method___init__(Closure& closure, Context& context);"s));
+            // the base class is defined first and passed as the parent
+            ASSERT(Contains(code, "Class_Shape::Define();\n    Class_Rect::Define();"s));
+            ASSERT(Contains(code, "std::move(methods), &aot::AsClass(Class_Shape::object)"s));
+            // Shape.area reads nothing and returns a constant
+            ASSERT(Contains(code, "aot::MakeMethod(NAME_"s) && Contains(code, "&Method_area, true)"s));
+            // parameters are bound once, variables are C++ locals
+            ASSERT(Contains(code, "aot::Variable v_w(closure, "s));
+            ASSERT(Contains(code, "aot::Variable v_r;"s));
+            ASSERT(Contains(code, "aot::Run(&RunProgram)"s));
+        }
+
+        void TestEmitOrder() {
+            auto program = ParseProgramFromString(R"(
+x = 1
+while x < 10:
+  if x == 5 or x == 7:
+    x = x + 2
+    continue
+  print 'x:', x
+  x = x + 1
+)"s);
+            const string code = Emit(program);
+
+            // both operands of or are evaluated before the result, as in the interpreter
+            ASSERT(Contains(code, "bool t7 = t4 || t6;"s));
+            // the loop condition is evaluated at the top of every iteration
+            ASSERT(Contains(code, "while (true) {\n            const runtime::ObjectHolder& t1 = v_x.Get();"s));
+            ASSERT(Contains(code, "continue;"s));
+            ASSERT(Contains(code, "\"x:\""s));
+        }
+
+        void TestUnsupportedNodes() {
+            auto program = ParseProgramFromString(R"(
+class Counter:
+  def __init__():
+    self.n = 0
+
+  def count(k):
+    if k == 0:
+      return self.n
+    self.n = self.n + 1
+    return self.count(k - 1)
+
+c = Counter()
+print c.count(5)
+)"s);
+            optimize::OptimizeProgram(program);
+
+            ASSERT_THROWS(Emit(program), std::runtime_error);
+        }
+    } // namespace
+
+    void RunTranspileTests(TestRunner& tr) {
+        RUN_TEST(tr, transpile::TestEmitClasses);
+        RUN_TEST(tr, transpile::TestEmitOrder);
+        RUN_TEST(tr, transpile::TestUnsupportedNodes);
+    }
+
+} // namespace transpile